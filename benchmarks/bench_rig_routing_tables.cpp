@@ -0,0 +1,241 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+
+#include "default_routes.h"
+#include "ordered_covering.h"
+#include "route_partition.h"
+#include "synthetic_tables.h"
+
+using OrderedCovering::AliasTable;
+using OrderedCovering::Merge;
+using RoutingTable::Table;
+
+
+// Every benchmark runs over tables of each combination of these parameters:
+// length, number of distinct routes and generality distribution.
+static void table_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"length", "routes", "generality"});
+  b->ArgsProduct({{256, 1024, 4096}, {4, 32},
+                  {SyntheticTables::EXACT, SyntheticTables::MIXED,
+                   SyntheticTables::GENERAL}});
+}
+
+static Table get_table(const benchmark::State& state)
+{
+  return SyntheticTables::generate(
+    state.range(0), state.range(1),
+    (SyntheticTables::Generality) state.range(2), 42
+  );
+}
+
+// Get the merge of every entry sharing the route of the largest route group,
+// this is the first candidate considered by get_best_merge.
+static Merge get_largest_group(const Table& table)
+{
+  auto routes = OrderedCovering::get_route_index(table);
+  const std::vector<unsigned int>* largest = nullptr;
+  for (const auto& group : routes)
+  {
+    if (!largest || group.second.size() > largest->size())
+    {
+      largest = &group.second;
+    }
+  }
+
+  auto merge = Merge(table.size(), false);
+  for (auto i : *largest)
+  {
+    merge.set(i);
+  }
+  return merge;
+}
+
+
+static void BM_KeyMaskIntersect(benchmark::State& state)
+{
+  auto table = get_table(state);
+  for (auto _ : state)
+  {
+    unsigned int hits = 0;
+    for (unsigned int i = 1; i < table.size(); i++)
+    {
+      hits += table[i - 1].keymask.intersect(table[i].keymask);
+    }
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(state.iterations() * (table.size() - 1));
+}
+BENCHMARK(BM_KeyMaskIntersect)->Apply(table_args);
+
+
+static void BM_MergeEntries(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto merge = get_largest_group(table);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(OrderedCovering::merge_entries(table, merge));
+  }
+}
+BENCHMARK(BM_MergeEntries)->Apply(table_args);
+
+
+static void BM_GetInsertionIndex(benchmark::State& state)
+{
+  auto table = get_table(state);
+  for (auto _ : state)
+  {
+    for (unsigned int g = 0; g <= 32; g++)
+    {
+      benchmark::DoNotOptimize(OrderedCovering::get_insertion_index(table, g));
+    }
+  }
+}
+BENCHMARK(BM_GetInsertionIndex)->Apply(table_args);
+
+
+static void BM_GetInsertionOffset(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto generality = OrderedCovering::get_generality_index(table);
+  for (auto _ : state)
+  {
+    for (unsigned int g = 0; g <= 32; g++)
+    {
+      benchmark::DoNotOptimize(
+        OrderedCovering::get_insertion_offset(generality, g)
+      );
+    }
+  }
+}
+BENCHMARK(BM_GetInsertionOffset)->Apply(table_args);
+
+
+static void BM_GetCoverInfo(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto aliases = AliasTable();
+  auto merge = get_largest_group(table);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(
+      OrderedCovering::get_cover_info(table, generality, aliases, merge)
+    );
+  }
+}
+BENCHMARK(BM_GetCoverInfo)->Apply(table_args);
+
+
+// The refinement benchmarks include the cost of copying the initial merge,
+// which is small in comparison.
+static void BM_RefineMergeDowncheck(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto aliases = AliasTable();
+  const auto initial = get_largest_group(table);
+  auto merge = initial;
+  for (auto _ : state)
+  {
+    merge = initial;
+    benchmark::DoNotOptimize(OrderedCovering::refine_merge_downcheck(
+      table, generality, aliases, merge, 0
+    ));
+  }
+}
+BENCHMARK(BM_RefineMergeDowncheck)->Apply(table_args);
+
+
+static void BM_RefineMergeUpcheck(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto generality = OrderedCovering::get_generality_index(table);
+  const auto initial = get_largest_group(table);
+  auto merge = initial;
+  for (auto _ : state)
+  {
+    merge = initial;
+    benchmark::DoNotOptimize(OrderedCovering::refine_merge_upcheck(
+      table, generality, merge, 0
+    ));
+  }
+}
+BENCHMARK(BM_RefineMergeUpcheck)->Apply(table_args);
+
+
+static void BM_GetBestMerge(benchmark::State& state)
+{
+  auto table = get_table(state);
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto aliases = AliasTable();
+  auto routes = OrderedCovering::get_route_index(table);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(OrderedCovering::get_best_merge(
+      table, generality, aliases, routes
+    ));
+  }
+}
+BENCHMARK(BM_GetBestMerge)->Apply(table_args);
+
+
+static void BM_Defaultable(benchmark::State& state)
+{
+  // Make every entry pass straight through the router so that each is
+  // checked against the rest of the table.
+  auto table = get_table(state);
+  for (auto& entry : table)
+  {
+    entry.route = ((entry.source << 3) & 0x38) | ((entry.source >> 3) & 0x7);
+  }
+
+  for (auto _ : state)
+  {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < table.size(); i++)
+    {
+      count += DefaultRoutes::defaultable(table, i);
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * table.size());
+}
+BENCHMARK(BM_Defaultable)->Apply(table_args);
+
+
+static void BM_DefaultRoutesMinimise(benchmark::State& state)
+{
+  auto table = get_table(state);
+  for (auto& entry : table)
+  {
+    entry.route = ((entry.source << 3) & 0x38) | ((entry.source >> 3) & 0x7);
+  }
+
+  for (auto _ : state)
+  {
+    auto minimised = table;
+    DefaultRoutes::minimise(minimised);
+    benchmark::DoNotOptimize(minimised.size());
+  }
+  state.SetItemsProcessed(state.iterations() * table.size());
+}
+BENCHMARK(BM_DefaultRoutesMinimise)->Apply(table_args);
+
+
+static void BM_RoutePartitionMinimise(benchmark::State& state)
+{
+  auto table = get_table(state);
+  for (auto _ : state)
+  {
+    auto minimised = table;
+    RoutePartition::minimise(minimised, 0);
+    benchmark::DoNotOptimize(minimised.size());
+  }
+  state.SetItemsProcessed(state.iterations() * table.size());
+}
+BENCHMARK(BM_RoutePartitionMinimise)->Apply(table_args);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,351 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "default_routes.h"
+#include "ordered_covering.h"
+#include "reductions.h"
+#include "route_partition.h"
+#include "table_file.h"
+
+
+// Run a minimiser over every table in a corpus of routing table files and
+// report the wall time taken per table, the compression achieved and the peak
+// memory used. The report is a flat JSON object so that it may be saved and
+// compared against a later run.
+//
+// Usage: rig-benchmark-corpus [--engine E] [--reduce] [--target N]
+//                             [--repeat R] [--report FILE] [--baseline FILE]
+//                             [--tolerance T] corpus...
+//
+// The engine is ordered-covering (OrderedCovering::minimise, the default) or
+// route-partition (RoutePartition::minimise); the report records which was
+// used by its index in that list. With --reduce duplicate and shadowed entries
+// are removed before minimising and default-routable entries after, as by
+// `rig-ordered-covering --reduce`, and the time taken to do so is included.
+//
+// With --baseline any metric which is worse than the baseline is reported and
+// the exit status is 2. Times and memory may be up to a fraction T worse
+// (default 0.1) before being reported; the number of output entries may not
+// increase at all.
+
+typedef std::vector<std::pair<std::string, double>> Report;
+
+// Minimisers which may be chosen with --engine
+enum Engine
+{
+  ORDERED_COVERING,  // OrderedCovering::minimise
+  ROUTE_PARTITION,   // RoutePartition::minimise
+  N_ENGINES
+};
+const char* engine_names[N_ENGINES] = {"ordered-covering", "route-partition"};
+
+
+// Get the value at a percentile of a sorted list (nearest rank)
+double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+
+  size_t rank = (size_t) ceil(p / 100.0 * sorted.size());
+  return sorted[rank ? rank - 1 : 0];
+}
+
+
+std::string to_json(const Report& report)
+{
+  std::ostringstream json;
+  json.precision(9);
+  json << "{\n";
+  for (unsigned int i = 0; i < report.size(); i++)
+  {
+    json << "  \"" << report[i].first << "\": " << report[i].second
+         << (i + 1 < report.size() ? ",\n" : "\n");
+  }
+  json << "}\n";
+  return json.str();
+}
+
+
+// Read the numeric fields of a flat JSON object as written by to_json
+std::map<std::string, double> read_json(const char* path)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    throw std::runtime_error(std::string("cannot read ") + path);
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string text = buffer.str();
+
+  auto values = std::map<std::string, double>();
+  for (size_t start = text.find('"'); start != std::string::npos;
+       start = text.find('"', start))
+  {
+    const size_t end = text.find('"', start + 1);
+    const size_t colon = text.find(':', end);
+    if (end == std::string::npos || colon == std::string::npos)
+    {
+      throw std::runtime_error(std::string("malformed report ") + path);
+    }
+
+    values[text.substr(start + 1, end - start - 1)] =
+      strtod(text.c_str() + colon + 1, nullptr);
+    start = text.find_first_of(",}", colon);
+  }
+  return values;
+}
+
+
+// Print how a report compares to a baseline, returning true if any metric has
+// regressed.
+bool compare(const Report& report,
+             const std::map<std::string, double>& baseline,
+             double tolerance)
+{
+  bool regressed = false;
+  fprintf(stdout, "%-16s %14s %14s %9s\n",
+          "metric", "baseline", "current", "change");
+
+  for (const auto& metric : report)
+  {
+    auto base = baseline.find(metric.first);
+    if (base == baseline.end())
+    {
+      continue;
+    }
+
+    // The output length may not grow at all, times and memory may grow by
+    // the tolerance, and the corpus and target must not change.
+    const auto& name = metric.first;
+    bool worse = false;
+    if (name == "output_entries")
+    {
+      worse = metric.second > base->second;
+    }
+    else if (name.find("time") != std::string::npos || name == "peak_rss_kb")
+    {
+      worse = metric.second > base->second * (1.0 + tolerance);
+    }
+    else if (metric.second != base->second)
+    {
+      fprintf(stdout, "warning: %s differs, the runs are not comparable\n",
+              name.c_str());
+    }
+
+    const double change = base->second ?
+      100.0 * (metric.second - base->second) / base->second : 0.0;
+    fprintf(stdout, "%-16s %14.6g %14.6g %+8.1f%%%s\n",
+            name.c_str(), base->second, metric.second, change,
+            worse ? "  REGRESSION" : "");
+    regressed = regressed || worse;
+  }
+
+  return regressed;
+}
+
+
+int main(int argc, char* argv[])
+{
+  Engine engine = ORDERED_COVERING;
+  bool reduce = false;
+  unsigned int target_length = 0;
+  unsigned int repeat = 1;
+  double tolerance = 0.1;
+  const char* report_path = nullptr;
+  const char* baseline_path = nullptr;
+  auto corpus = std::vector<const char*>();
+
+  for (int i = 1; i < argc; i++)
+  {
+    auto option = [&] (const char* name) {
+      return !strcmp(argv[i], name) && i + 1 < argc;
+    };
+
+    if (option("--engine"))
+    {
+      const char* name = argv[++i];
+      engine = N_ENGINES;
+      for (unsigned int e = 0; e < N_ENGINES; e++)
+      {
+        if (!strcmp(name, engine_names[e]))
+        {
+          engine = (Engine) e;
+        }
+      }
+
+      if (engine == N_ENGINES)
+      {
+        fprintf(stderr, "rig-benchmark-corpus: unknown engine %s\n", name);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--reduce"))
+    {
+      reduce = true;
+    }
+    else if (option("--target"))
+    {
+      target_length = atoi(argv[++i]);
+    }
+    else if (option("--repeat"))
+    {
+      repeat = std::max(1, atoi(argv[++i]));
+    }
+    else if (option("--report"))
+    {
+      report_path = argv[++i];
+    }
+    else if (option("--baseline"))
+    {
+      baseline_path = argv[++i];
+    }
+    else if (option("--tolerance"))
+    {
+      tolerance = atof(argv[++i]);
+    }
+    else
+    {
+      corpus.push_back(argv[i]);
+    }
+  }
+
+  if (corpus.empty())
+  {
+    fprintf(stderr, "Usage: rig-benchmark-corpus [--engine E] [--reduce] "
+                    "[--target N]\n"
+                    "                            [--repeat R] [--report FILE] "
+                    "[--baseline FILE]\n"
+                    "                            [--tolerance T] corpus...\n");
+    return 1;
+  }
+
+  // Minimise every table, recording the fastest wall time of each
+  auto times = std::vector<double>();
+  double input_entries = 0, reduced_entries = 0, output_entries = 0;
+  auto workspace = OrderedCovering::Workspace();
+  auto aliases = OrderedCovering::AliasTable();
+  try
+  {
+    for (auto path : corpus)
+    {
+      RoutingTable::MappedTableFile file(path);
+      for (const auto& view : file)
+      {
+        double best = INFINITY;
+        size_t length = view.length, reduced = view.length;
+        for (unsigned int r = 0; r < repeat; r++)
+        {
+          auto table = view.to_table();
+          aliases.clear();
+          auto start = std::chrono::steady_clock::now();
+          if (reduce && table.size() > target_length)
+          {
+            Reductions::remove_duplicates(table);
+            Reductions::remove_shadowed(table);
+          }
+          reduced = table.size();
+
+          if (engine == ORDERED_COVERING)
+          {
+            OrderedCovering::minimise(table, target_length, aliases,
+                                      workspace);
+          }
+          else
+          {
+            RoutePartition::minimise(table, target_length);
+          }
+
+          // A merge may cover the keys of a pass-through entry which is no
+          // longer in the table, so default routes are only removed once the
+          // table has been minimised.
+          if (reduce && table.size() > target_length)
+          {
+            DefaultRoutes::minimise(table);
+          }
+          auto end = std::chrono::steady_clock::now();
+
+          best = std::min(best,
+                          std::chrono::duration<double>(end - start).count());
+          length = table.size();
+        }
+
+        times.push_back(best);
+        input_entries += view.length;
+        reduced_entries += reduced;
+        output_entries += length;
+      }
+    }
+  }
+  catch (const std::runtime_error& e)
+  {
+    fprintf(stderr, "rig-benchmark-corpus: %s\n", e.what());
+    return 1;
+  }
+
+  double total_time = 0.0;
+  for (auto t : times)
+  {
+    total_time += t;
+  }
+  std::sort(times.begin(), times.end());
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  const Report report = {
+    {"engine", (double) engine},
+    {"tables", (double) times.size()},
+    {"reduce", (double) reduce},
+    {"input_entries", input_entries},
+    {"reduced_entries", reduced_entries},
+    {"output_entries", output_entries},
+    {"target_length", (double) target_length},
+    {"total_time_s", total_time},
+    {"p50_time_s", percentile(times, 50)},
+    {"p95_time_s", percentile(times, 95)},
+    {"p99_time_s", percentile(times, 99)},
+    {"max_time_s", times.empty() ? 0.0 : times.back()},
+    {"peak_rss_kb", (double) usage.ru_maxrss},
+  };
+
+  const auto json = to_json(report);
+  fputs(json.c_str(), stdout);
+  if (report_path)
+  {
+    std::ofstream out(report_path);
+    if (!(out << json))
+    {
+      fprintf(stderr, "rig-benchmark-corpus: cannot write %s\n", report_path);
+      return 1;
+    }
+  }
+
+  if (baseline_path)
+  {
+    try
+    {
+      if (compare(report, read_json(baseline_path), tolerance))
+      {
+        return 2;
+      }
+    }
+    catch (const std::runtime_error& e)
+    {
+      fprintf(stderr, "rig-benchmark-corpus: %s\n", e.what());
+      return 1;
+    }
+  }
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ordered_covering.h"
+#include "routing_table.h"
+#include "table_file.h"
+
+
+// Generate a corpus of routing tables modelled on a SpiNNaker machine.
+//
+// Every core of a width x height machine sources a number of nets. The keys of
+// a net are laid out as
+//
+//   [31:24] x  [23:16] y  [15:11] core  [10:0] neuron
+//
+// with each net covering a power-of-two block of neurons, so a net is a single
+// key-mask. Each net is sent to a few random cores near its source using
+// dimension-order routing (along x and then along y) and every chip on the
+// route gains an entry for the net.
+//
+// The corpus is written as a legacy file unless `--format container` or
+// `--compress` is given, see table_file.h.
+
+// Link directions in the order of their bits in a route
+enum Link
+{
+  EAST = 0, NORTH_EAST = 1, NORTH = 2, WEST = 3, SOUTH_WEST = 4, SOUTH = 5,
+};
+
+struct Options
+{
+  unsigned int width = 8, height = 8;
+  unsigned int cores = 16;          // Application cores per chip
+  unsigned int nets_per_core = 4;
+  unsigned int fan_out = 4;         // Targets per net
+  unsigned int radius = 3;          // Maximum distance to a target
+  unsigned int seed = 1;
+};
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  const std::pair<const char*, unsigned int*> numeric_options[] = {
+    {"--width", &options.width},
+    {"--height", &options.height},
+    {"--cores", &options.cores},
+    {"--nets-per-core", &options.nets_per_core},
+    {"--fan-out", &options.fan_out},
+    {"--radius", &options.radius},
+    {"--seed", &options.seed},
+  };
+
+  const char* out_path = nullptr;
+  auto format = RoutingTable::LEGACY;
+  bool compress = false;
+  bool valid = true;
+  for (int i = 1; i < argc; i++)
+  {
+    bool matched = false;
+    if (!strcmp(argv[i], "--format") && i + 1 < argc)
+    {
+      const char* name = argv[++i];
+      valid = valid && (!strcmp(name, "legacy") ||
+                        !strcmp(name, "container"));
+      format = strcmp(name, "container") ? RoutingTable::LEGACY
+                                         : RoutingTable::CONTAINER;
+      matched = true;
+    }
+    else if (!strcmp(argv[i], "--compress"))
+    {
+      format = RoutingTable::CONTAINER;
+      compress = true;
+      matched = true;
+    }
+
+    for (const auto& option : numeric_options)
+    {
+      if (!strcmp(argv[i], option.first) && i + 1 < argc)
+      {
+        *option.second = atoi(argv[++i]);
+        matched = true;
+        break;
+      }
+    }
+
+    if (!matched)
+    {
+      valid = valid && !out_path;
+      out_path = argv[i];
+    }
+  }
+
+  if (!valid || !out_path || !options.width || !options.height ||
+      !options.cores || options.width > 256 || options.height > 256 ||
+      options.cores > 26)
+  {
+    fprintf(stderr,
+            "Usage: rig-generate-corpus [--width W] [--height H] [--cores C] "
+            "[--nets-per-core N]\n"
+            "                           [--fan-out F] [--radius R] [--seed S]"
+            "\n"
+            "                           [--format legacy|container] "
+            "[--compress] out_file\n");
+    return 1;
+  }
+
+  std::mt19937 rng(options.seed);
+  auto tables = std::map<std::pair<unsigned int, unsigned int>,
+                         RoutingTable::Table>();
+
+  for (unsigned int sx = 0; sx < options.width; sx++)
+  {
+    for (unsigned int sy = 0; sy < options.height; sy++)
+    {
+      for (unsigned int core = 0; core < options.cores; core++)
+      {
+        // Allocate power-of-two neuron blocks from the 11 bits of the core
+        uint32_t next_neuron = 0;
+        for (unsigned int n = 0; n < options.nets_per_core; n++)
+        {
+          const uint32_t size = 1u << (4 + rng() % 5);
+          next_neuron = (next_neuron + size - 1) & ~(size - 1);
+          if (next_neuron + size > (1u << 11))
+          {
+            break;
+          }
+          const RoutingTable::KeyMask km = {
+            (sx << 24) | (sy << 16) | (core << 11) | next_neuron,
+            ~(size - 1)
+          };
+          next_neuron += size;
+
+          // Routes of the net at each chip it passes through and the links by
+          // which it arrives there.
+          auto routes = std::map<std::pair<unsigned int, unsigned int>,
+                                 std::pair<uint32_t, uint32_t>>();
+          routes[{sx, sy}].first |= 1u << (6 + core);
+
+          for (unsigned int t = 0; t < options.fan_out; t++)
+          {
+            const int dx = ((int) (rng() % (2 * options.radius + 1))) -
+                           (int) options.radius;
+            const int dy = ((int) (rng() % (2 * options.radius + 1))) -
+                           (int) options.radius;
+            const unsigned int tx = (sx + options.width + dx) % options.width;
+            const unsigned int ty = (sy + options.height + dy) %
+                                    options.height;
+
+            // Walk along x and then y on the torus
+            unsigned int x = sx, y = sy;
+            while (x != tx || y != ty)
+            {
+              Link link;
+              unsigned int nx = x, ny = y;
+              if (x != tx)
+              {
+                link = dx > 0 ? EAST : WEST;
+                nx = (x + options.width + (dx > 0 ? 1 : -1)) % options.width;
+              }
+              else
+              {
+                link = dy > 0 ? NORTH : SOUTH;
+                ny = (y + options.height + (dy > 0 ? 1 : -1)) % options.height;
+              }
+
+              routes[{x, y}].second |= 1u << link;
+              routes[{nx, ny}].first |= 1u << ((link + 3) % 6);
+              x = nx;
+              y = ny;
+            }
+            routes[{tx, ty}].second |= 1u << (6 + rng() % options.cores);
+          }
+
+          // The source field holds the links by which packets arrive, or the
+          // core on the source chip.
+          for (const auto& chip_route : routes)
+          {
+            if (chip_route.second.second)
+            {
+              tables[chip_route.first].push_back(
+                {km, chip_route.second.first, chip_route.second.second}
+              );
+            }
+          }
+        }
+      }
+    }
+  }
+
+  FILE* out = fopen(out_path, "wb");
+  if (!out)
+  {
+    fprintf(stderr, "rig-generate-corpus: cannot open %s\n", out_path);
+    return 1;
+  }
+
+  size_t n_entries = 0;
+  try
+  {
+    RoutingTable::TableWriter writer(out, out_path, format, compress);
+    for (auto& chip_table : tables)
+    {
+      auto& table = chip_table.second;
+      OrderedCovering::sort_table(table);
+      writer.write(chip_table.first.first, chip_table.first.second,
+                   table.data(), table.size());
+      n_entries += table.size();
+    }
+    writer.close();
+  }
+  catch (const std::runtime_error& e)
+  {
+    fprintf(stderr, "rig-generate-corpus: %s\n", e.what());
+    fclose(out);
+    return 1;
+  }
+  fclose(out);
+
+  fprintf(stdout, "%zu tables, %zu entries\n", tables.size(), n_entries);
+}
@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <random>
+#include <set>
+
+#include "ordered_covering.h"
+#include "routing_table.h"
+
+#pragma once
+
+namespace SyntheticTables
+{
+
+/*****************************************************************************/
+/* Synthetic routing tables **************************************************/
+// How many Xs the entries of a synthetic table contain
+enum Generality
+{
+  EXACT = 0,    // No entry contains an X
+  MIXED = 1,    // A quarter of the entries contain up to 5 Xs
+  GENERAL = 2,  // Every entry contains between 1 and 8 Xs
+};
+
+// Generate a routing table of `length` distinct key-masks sorted by
+// generality. The same seed always gives the same table. Routes are drawn
+// from `n_routes` distinct route values and each entry arrives by a single
+// link.
+inline RoutingTable::Table generate(unsigned int length,
+                                    unsigned int n_routes,
+                                    Generality generality,
+                                    uint32_t seed)
+{
+  std::mt19937 rng(seed);
+
+  // Keys are drawn from a space a few times larger than the table so that
+  // there is a mix of entries which may and may not be merged.
+  unsigned int key_bits = 4;
+  while ((1u << key_bits) < length * 4)
+  {
+    key_bits++;
+  }
+  const uint32_t key_space = (1u << key_bits) - 1;
+
+  // Route values use the six links and up to 26 cores
+  auto routes = std::vector<uint32_t>();
+  for (unsigned int r = 0; r < n_routes; r++)
+  {
+    routes.push_back((1u << (rng() % 32)) | (rng() % 2 ? 1u << (rng() % 6)
+                                                       : 0));
+  }
+
+  auto table = RoutingTable::Table();
+  auto seen = std::set<RoutingTable::KeyMask>();
+  while (table.size() < length)
+  {
+    unsigned int n_xs = 0;
+    if (generality == MIXED && rng() % 4 == 0)
+    {
+      n_xs = rng() % 6;
+    }
+    else if (generality == GENERAL)
+    {
+      n_xs = 1 + rng() % 8;
+    }
+
+    uint32_t mask = 0xffffffff;
+    for (unsigned int i = 0; i < n_xs; i++)
+    {
+      mask &= ~(1u << (rng() % key_bits));
+    }
+    const RoutingTable::KeyMask km = {(uint32_t) rng() & key_space & mask,
+                                      mask};
+
+    if (seen.insert(km).second)
+    {
+      table.push_back({km, 1u << (rng() % 6), routes[rng() % routes.size()]});
+    }
+  }
+
+  OrderedCovering::sort_table(table);
+  return table;
+}
+/*****************************************************************************/
+
+}
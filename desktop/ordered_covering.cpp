@@ -1,65 +1,558 @@
+#include <chrono>
 #include <ctime>
-#include <iostream>
-#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bounded_covering.h"
+#include "bounded_queue.h"
 #include "ordered_covering.h"
 #include "default_routes.h"
+#include "reductions.h"
+#include "route_partition.h"
+#include "table_file.h"
+
+
+// Reductions which may be applied, in this order, to a table. Default routes
+// are only removed once the table has been minimised: the minimisers avoid
+// covering the keys of the entries in the table, so a merge could cover the
+// keys of a pass-through entry which had already been removed and route them
+// away from the opposite link.
+enum Reduction
+{
+  DUPLICATES,      // Reductions::remove_duplicates
+  SHADOWED,        // Reductions::remove_shadowed
+  DEFAULT_ROUTES,  // DefaultRoutes::minimise
+  N_REDUCTIONS
+};
+const char* reduction_names[N_REDUCTIONS] = {
+  "duplicates", "shadowed", "default_routes",
+};
+const char* reduction_flags[N_REDUCTIONS] = {
+  "--remove-duplicates", "--remove-shadowed", "--remove-default-routes",
+};
+
+// A routing table passing through the pipeline
+struct Job
+{
+  unsigned int index;            // Position of the table in the input
+  RoutingTable::TableView view;  // The original table
+
+  // Storage for the table if it was read from a stream, and the minimised
+  // table if it was minimised.
+  RoutingTable::Table table;
+  bool minimised;
+  float time;  // CPU time taken to minimise the table
+  OrderedCovering::Status status;
+  OrderedCovering::Stats stats;  // Collected only with --stats
+  unsigned int removed[N_REDUCTIONS];  // Entries removed by each reduction
+  size_t arena_bytes;  // Most arena memory used, by bounded covering only
+};
+
+// Names of the reasons that minimisation may stop
+const char* status_names[] = {
+  "target_met", "no_merges", "timed_out", "out_of_iterations", "cancelled",
+  "out_of_memory",
+};
+
+// Minimisers which may be chosen with --engine
+enum Engine
+{
+  ORDERED_COVERING,  // OrderedCovering::minimise
+  ROUTE_PARTITION,   // RoutePartition::minimise, faster but less thorough
+  BOUNDED_COVERING,  // BoundedCovering::minimise, within a fixed arena
+  N_ENGINES
+};
+const char* engine_names[N_ENGINES] = {
+  "ordered-covering", "route-partition", "bounded-covering",
+};
+
+// Memory available to each minimiser with --engine bounded-covering, as would
+// be on a SpiNNaker chip.
+const size_t ARENA_CAPACITY = 1 << 20;
+
+// Order jobs such that the largest table is minimised first
+struct LargestFirst
+{
+  bool operator()(const Job& a, const Job& b) const
+  {
+    return (a.view.length < b.view.length ||
+            (a.view.length == b.view.length && a.index > b.index));
+  }
+};
+
+// Order jobs such that they are written in their original order
+struct EarliestFirst
+{
+  bool operator()(const Job& a, const Job& b) const
+  {
+    return a.index > b.index;
+  }
+};
+
+
+// Get the CPU time used by the calling thread
+float thread_time()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec / 1e9f;
+}
 
 
 int main(int argc, char* argv[])
 {
   // We expect two arguments; an input routing table file and an output routing
-  // table file. An optional 4th argument is the target length of the routing
-  // table.
-  if (argc < 3)
+  // table file, either of which may be `-` to use stdin or stdout. An optional
+  // 3rd argument is the target length of the routing table. `--jobs N`
+  // minimises up to N tables at once (0 to use every processor),
+  // `--time-limit S` stops minimising any table after S seconds and
+  // `--stats` reports statistics on the minimisation of each table as a line
+  // of JSON. `--engine NAME` chooses the minimiser, the time limit and the
+  // statistics apply only to ordered covering (the default). Bounded covering
+  // stops early, with status out_of_memory, if it exhausts its arena; the most
+  // arena memory it used is reported with --stats.
+  // `--remove-duplicates`, `--remove-shadowed` and `--remove-default-routes`
+  // remove entries which cannot affect routing, the first two before
+  // minimising and the last after, `--reduce` enables all three. The number of entries each removes is reported.
+  // Tables are read in either file format; `--format container` writes a
+  // container rather than a legacy file and `--compress` (which implies it)
+  // compresses the tables.
+  auto args = std::vector<char*>();
+  unsigned int jobs = 1;
+  double time_limit = 0.0;
+  bool stats = false;
+  Engine engine = ORDERED_COVERING;
+  bool reductions[N_REDUCTIONS] = {};
+  bool any_reductions = false;
+  auto format = RoutingTable::LEGACY;
+  bool compress = false;
+  for (int i = 1; i < argc; i++)
   {
-    fprintf(stderr, "Usage: rig-ordered-covering in_file out_file [target length]\n");
+    // Reductions are enabled individually or all together by `--reduce`
+    const bool all = !strcmp(argv[i], "--reduce");
+    bool reduction = all;
+    for (unsigned int r = 0; r < N_REDUCTIONS; r++)
+    {
+      if (all || !strcmp(argv[i], reduction_flags[r]))
+      {
+        reductions[r] = any_reductions = reduction = true;
+      }
+    }
+
+    if (reduction)
+    {
+      continue;
+    }
+    if ((!strcmp(argv[i], "--jobs") || !strcmp(argv[i], "-j")) && i + 1 < argc)
+    {
+      jobs = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--time-limit") && i + 1 < argc)
+    {
+      time_limit = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--stats"))
+    {
+      stats = true;
+    }
+    else if (!strcmp(argv[i], "--format") && i + 1 < argc)
+    {
+      const char* name = argv[++i];
+      if (!strcmp(name, "legacy"))
+      {
+        format = RoutingTable::LEGACY;
+      }
+      else if (!strcmp(name, "container"))
+      {
+        format = RoutingTable::CONTAINER;
+      }
+      else
+      {
+        fprintf(stderr, "rig-ordered-covering: unknown format %s\n", name);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--compress"))
+    {
+      compress = true;
+    }
+    else if (!strcmp(argv[i], "--engine") && i + 1 < argc)
+    {
+      const char* name = argv[++i];
+      engine = N_ENGINES;
+      for (unsigned int e = 0; e < N_ENGINES; e++)
+      {
+        if (!strcmp(name, engine_names[e]))
+        {
+          engine = (Engine) e;
+        }
+      }
+
+      if (engine == N_ENGINES)
+      {
+        fprintf(stderr, "rig-ordered-covering: unknown engine %s\n", name);
+        return 1;
+      }
+    }
+    else
+    {
+      args.push_back(argv[i]);
+    }
   }
 
-  // Prepare the input and output streams; for each routing table in the input
-  // file we minimise it and then write it out to file immediately.
-  std::ifstream in  (argv[1], std::ios::in | std::ios::binary);
-  std::ofstream out (argv[2], std::ios::out | std::ios::binary);
+  if (args.size() < 2)
+  {
+    fprintf(stderr, "Usage: rig-ordered-covering [--jobs N] [--time-limit S] "
+                    "[--stats]\n"
+                    "                            [--engine ordered-covering|"
+                    "route-partition|\n"
+                    "                             bounded-covering]\n"
+                    "                            [--reduce] "
+                    "[--remove-duplicates] [--remove-shadowed]\n"
+                    "                            [--remove-default-routes]\n"
+                    "                            [--format legacy|container] "
+                    "[--compress]\n"
+                    "                            in_file out_file "
+                    "[target length]\n");
+    return 1;
+  }
+
+  if (compress)
+  {
+    format = RoutingTable::CONTAINER;
+  }
+
+  if (jobs == 0)
+  {
+    jobs = std::thread::hardware_concurrency();
+  }
 
   // Get the target length
   unsigned int target_length = 0;
-  if (argc == 4)
+  if (args.size() == 3)
+  {
+    target_length = atoi(args[2]);
+  }
+
+  // Open the input and output. Files are mapped into memory and checked
+  // before any work is done; streams are checked as they are read.
+  const bool in_stream = !strcmp(args[0], "-");
+  const bool out_stream = !strcmp(args[1], "-");
+
+  std::unique_ptr<RoutingTable::MappedTableFile> in_file;
+  try
+  {
+    if (!in_stream)
+    {
+      in_file.reset(new RoutingTable::MappedTableFile(args[0]));
+    }
+  }
+  catch (const std::runtime_error& e)
   {
-    target_length = atoi(argv[3]);
+    fprintf(stderr, "rig-ordered-covering: %s\n", e.what());
+    return 1;
   }
 
-  while (!in.eof())
-  {
-    // The first two bytes are the co-ordinates of the routing table.
-    unsigned char x, y;
-    in.read((char *) &x, 1);
-    in.read((char *) &y, 1);
-    fprintf(stdout, "(%3u, %3u)\t", x, y);
-
-    // The next short is the original length of the table
-    unsigned short length;
-    in.read((char *) &length, 2);
-    fprintf(stdout, "%5u\t", length);
-
-    // Create the table and iterate through adding entries
-    auto table = RoutingTable::Table(length);
-    in.read((char *) &(table[0]), sizeof(RoutingTable::Entry) * length);
-
-    // Minimise the table
-    auto t = clock();
-    OrderedCovering::minimise(table, target_length);
-    float time = ((float) (clock() - t)) / CLOCKS_PER_SEC;
-    fprintf(stdout, "%5u\t%f s\n", (unsigned int) table.size(), time);
-
-    // Write the table out again
-    // (BYTE: x, BYTE: y, SHORT: length)
-    auto new_length = table.size();
-    out.write((char *) &x, 1);
-    out.write((char *) &y, 1);
-    out.write((char *) &new_length, 2);
-
-    // Dump out the table
-    out.write((char *) &table[0], sizeof(RoutingTable::Entry) * new_length);
+  FILE* out_file = out_stream ? stdout : fopen(args[1], "wb");
+  if (!out_file)
+  {
+    fprintf(stderr, "rig-ordered-covering: cannot open %s\n", args[1]);
+    return 1;
+  }
+
+  // The per-table report is written to stderr if stdout holds the tables
+  FILE* report = out_stream ? stderr : stdout;
+
+  // The tables pass through three stages: a reader, `jobs` minimisers and a
+  // writer (this thread). No more than `window` tables are held in memory at
+  // once; the minimisers start on the largest table they have available and
+  // the writer puts the tables back into their original order.
+  const unsigned int window = 4 * jobs;
+  Parallel::Semaphore in_flight(window);
+  Parallel::BoundedQueue<Job, LargestFirst> to_minimise(window);
+  Parallel::BoundedQueue<Job, EarliestFirst> to_write(window);
+  std::string read_error;
+
+  std::thread reader([&] ()
+  {
+    try
+    {
+      if (in_file)
+      {
+        for (unsigned int i = 0; i < in_file->size(); i++)
+        {
+          in_flight.acquire();
+          to_minimise.push({i, (*in_file)[i], {}, false, 0.0f,
+                           OrderedCovering::TARGET_MET, {}});
+        }
+      }
+      else
+      {
+        RoutingTable::TableReader reader(stdin, "<stdin>");
+        for (unsigned int i = 0; ; i++)
+        {
+          in_flight.acquire();
+
+          Job job = {i, {0, 0, 0, nullptr}, {}, false, 0.0f,
+                     OrderedCovering::TARGET_MET, {}};
+          if (!reader.next(job.view.x, job.view.y, job.table))
+          {
+            in_flight.release();
+            break;
+          }
+          job.view.length = job.table.size();
+          job.view.entries = job.table.data();
+          to_minimise.push(std::move(job));
+        }
+      }
+    }
+    catch (const std::runtime_error& e)
+    {
+      read_error = e.what();
+    }
+    to_minimise.close();
+  });
+
+  auto minimisers = std::vector<std::thread>();
+  for (unsigned int i = 0; i < jobs; i++)
+  {
+    minimisers.emplace_back([&] ()
+    {
+      // Each minimiser reuses its workspace and aliases for every table
+      auto workspace = OrderedCovering::Workspace();
+      auto aliases = OrderedCovering::AliasTable();
+      auto arena = std::unique_ptr<RoutingTable::FixedArena<ARENA_CAPACITY>>();
+      if (engine == BOUNDED_COVERING)
+      {
+        arena.reset(new RoutingTable::FixedArena<ARENA_CAPACITY>());
+      }
+
+      Job job;
+      while (to_minimise.pop(job))
+      {
+        // Tables which are already short enough are written out unchanged
+        if (job.view.length > target_length)
+        {
+          auto t = thread_time();
+          if (job.table.data() != job.view.entries)
+          {
+            job.table = job.view.to_table();
+          }
+
+          // Statistics are only collected when asked for so that the
+          // minimiser is otherwise free of their overhead.
+          aliases.clear();
+          auto limits = OrderedCovering::Limits();
+          if (time_limit > 0.0)
+          {
+            limits.deadline = std::chrono::steady_clock::now() +
+              std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(time_limit));
+          }
+
+          // Remove the entries which cannot affect routing so that the
+          // minimiser starts from the smallest equivalent table.
+          for (unsigned int r = 0; r < DEFAULT_ROUTES; r++)
+          {
+            const unsigned int length = job.table.size();
+            if (!reductions[r] || length <= target_length)
+            {
+              continue;
+            }
+
+            switch (r)
+            {
+              case DUPLICATES:
+                Reductions::remove_duplicates(job.table);
+                break;
+              case SHADOWED:
+                Reductions::remove_shadowed(job.table);
+                break;
+            }
+            job.removed[r] = length - job.table.size();
+          }
+
+          if (job.table.size() <= target_length)
+          {
+            job.status = OrderedCovering::TARGET_MET;
+          }
+          else if (engine == ROUTE_PARTITION)
+          {
+            RoutePartition::minimise(job.table, target_length);
+            job.status = job.table.size() <= target_length ?
+              OrderedCovering::TARGET_MET : OrderedCovering::NO_MERGES;
+          }
+          else if (engine == BOUNDED_COVERING)
+          {
+            arena->reset_high_water();
+            job.status = BoundedCovering::minimise(job.table, target_length,
+                                                   *arena);
+            job.arena_bytes = arena->high_water();
+          }
+          else if (stats)
+          {
+            job.status = OrderedCovering::minimise(
+              job.table, target_length, aliases, workspace, limits, job.stats
+            );
+          }
+          else
+          {
+            job.status = OrderedCovering::minimise(
+              job.table, target_length, aliases, workspace, limits
+            );
+          }
+
+          // See Reduction
+          const unsigned int length = job.table.size();
+          if (reductions[DEFAULT_ROUTES] && length > target_length)
+          {
+            DefaultRoutes::minimise(job.table);
+            job.removed[DEFAULT_ROUTES] = length - job.table.size();
+            if (job.table.size() <= target_length)
+            {
+              job.status = OrderedCovering::TARGET_MET;
+            }
+          }
+          job.minimised = true;
+          job.time = thread_time() - t;
+        }
+        to_write.push(std::move(job));
+      }
+    });
+  }
+
+  // Close the final queue once every table has been minimised
+  std::thread closer([&] ()
+  {
+    for (auto& minimiser : minimisers)
+    {
+      minimiser.join();
+    }
+    to_write.close();
+  });
+
+  // Report on and write out the tables in their original order, batching
+  // the records into large writes.
+  std::string write_error;
+  {
+    RoutingTable::TableWriter writer(out_file, args[1], format, compress);
+    auto pending = std::map<unsigned int, Job>();
+    unsigned int next = 0;
+
+    Job job;
+    while (to_write.pop(job))
+    {
+      pending[job.index] = std::move(job);
+      for (auto p = pending.find(next); p != pending.end();
+           p = pending.find(++next))
+      {
+        const auto& done = p->second;
+        const auto& view = done.view;
+        const auto* entries = done.minimised ? done.table.data()
+                                             : view.entries;
+        const uint32_t new_length = done.minimised ? done.table.size()
+                                                   : view.length;
+
+        // The entries removed by each reduction are only reported if any
+        // reductions were enabled.
+        std::string removed;
+        for (unsigned int r = 0; r < N_REDUCTIONS; r++)
+        {
+          if (reductions[r])
+          {
+            char field[64];
+            if (stats)
+            {
+              snprintf(field, sizeof(field), "%s\"%s\": %u",
+                       removed.empty() ? "" : ", ",
+                       reduction_names[r], done.removed[r]);
+            }
+            else
+            {
+              snprintf(field, sizeof(field), "\t%s -%u",
+                       reduction_names[r], done.removed[r]);
+            }
+            removed += field;
+          }
+        }
+
+        if (stats)
+        {
+          fprintf(report, "{\"x\": %u, \"y\": %u, \"length\": %u, "
+                          "\"new_length\": %u, \"time_s\": %f, "
+                          "\"status\": \"%s\", \"stats\": %s",
+                  view.x, view.y, view.length, new_length, done.time,
+                  status_names[done.status], done.stats.to_json().c_str());
+          if (any_reductions)
+          {
+            fprintf(report, ", \"reductions\": {%s}", removed.c_str());
+          }
+          if (engine == BOUNDED_COVERING)
+          {
+            fprintf(report, ", \"arena_bytes\": %zu", done.arena_bytes);
+          }
+          fprintf(report, "}\n");
+        }
+        else
+        {
+          fprintf(report, "(%3u, %3u)\t", view.x, view.y);
+          fprintf(report, "%5u\t", view.length);
+          fprintf(report, "%5u\t%f s%s%s\n", new_length, done.time,
+                  done.status == OrderedCovering::TIMED_OUT ? "\ttimed out" :
+                  done.status == OrderedCovering::OUT_OF_MEMORY ?
+                    "\tout of memory" : "",
+                  removed.c_str());
+        }
+
+        // After a write error the remaining tables are discarded so that the
+        // other stages can finish.
+        if (write_error.empty())
+        {
+          try
+          {
+            writer.write(view.x, view.y, entries, new_length);
+          }
+          catch (const std::runtime_error& e)
+          {
+            write_error = e.what();
+          }
+        }
+
+        pending.erase(p);
+        in_flight.release();
+      }
+    }
+
+    if (write_error.empty())
+    {
+      try
+      {
+        writer.close();
+      }
+      catch (const std::runtime_error& e)
+      {
+        write_error = e.what();
+      }
+    }
+  }
+
+  reader.join();
+  closer.join();
+  if (!out_stream)
+  {
+    fclose(out_file);
+  }
+
+  if (!read_error.empty() || !write_error.empty())
+  {
+    fprintf(stderr, "rig-ordered-covering: %s\n",
+            (read_error.empty() ? write_error : read_error).c_str());
+    return 1;
   }
 }
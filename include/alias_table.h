@@ -0,0 +1,353 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "routing_table.h"
+
+#pragma once
+
+namespace OrderedCovering
+{
+/* Alias table types *********************************************************/
+// Map of key-masks to the key-masks of the original entries which they
+// replaced, used to pass aliases into and out of the minimiser.
+typedef std::map<RoutingTable::KeyMask,
+                 std::set<RoutingTable::KeyMask>> Aliases;
+
+// Flat open-addressing hash table mapping key-masks to the key-masks of the
+// original entries which they replaced. The aliases of every key-mask are
+// stored contiguously in a single arena so that looking up and scanning the
+// aliases of an entry touches as little memory as possible.
+class AliasTable
+{
+  public:
+    // Contiguous list of the aliases of a key-mask
+    class Range
+    {
+      public:
+        Range(const RoutingTable::KeyMask* begin,
+              const RoutingTable::KeyMask* end) :
+          m_begin(begin), m_end(end) {}
+
+        const RoutingTable::KeyMask* begin() const
+        {
+          return m_begin;
+        }
+
+        const RoutingTable::KeyMask* end() const
+        {
+          return m_end;
+        }
+
+        size_t size() const
+        {
+          return m_end - m_begin;
+        }
+
+        bool empty() const
+        {
+          return m_begin == m_end;
+        }
+
+      private:
+        const RoutingTable::KeyMask* m_begin;
+        const RoutingTable::KeyMask* m_end;
+    };
+
+    AliasTable() : m_slots(16), m_size(0), m_used(0), m_dead(0) {}
+
+    explicit AliasTable(const Aliases& aliases) : AliasTable()
+    {
+      for (const auto& km_aliases : aliases)
+      {
+        for (const auto& alias : km_aliases.second)
+        {
+          insert(km_aliases.first, alias);
+        }
+      }
+    }
+
+    // Convert back into a map of sets
+    Aliases to_aliases() const
+    {
+      auto aliases = Aliases();
+      for (const auto& slot : m_slots)
+      {
+        if (slot.offset < DELETED)
+        {
+          auto& set = aliases[slot.keymask];
+          set.insert(m_arena.begin() + slot.offset,
+                     m_arena.begin() + slot.offset + slot.length);
+        }
+      }
+      return aliases;
+    }
+
+    // Number of key-masks with aliases
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    size_t count(const RoutingTable::KeyMask& km) const
+    {
+      return find_slot(km) != NOT_FOUND ? 1 : 0;
+    }
+
+    // Get the aliases of a key-mask, the range is empty if there are none.
+    // The range is invalidated by any modification of the table.
+    Range lookup(const RoutingTable::KeyMask& km) const
+    {
+      auto i = find_slot(km);
+      if (i == NOT_FOUND)
+      {
+        return Range(nullptr, nullptr);
+      }
+
+      const auto* list = m_arena.data() + m_slots[i].offset;
+      return Range(list, list + m_slots[i].length);
+    }
+
+    // Add an alias to a key-mask
+    void insert(const RoutingTable::KeyMask& km,
+                const RoutingTable::KeyMask& alias)
+    {
+      auto& slot = get_slot(km);
+      make_tail(slot);
+      m_arena.push_back(alias);
+      slot.length++;
+    }
+
+    // Replace old_km with new_km; if old_km has aliases then they are moved
+    // to new_km, otherwise old_km itself becomes an alias of new_km.
+    void replace(const RoutingTable::KeyMask& new_km,
+                 const RoutingTable::KeyMask& old_km)
+    {
+      auto i = find_slot(old_km);
+      if (i == NOT_FOUND)
+      {
+        insert(new_km, old_km);
+        return;
+      }
+
+      // Remove the old key-mask, its aliases remain in the arena until they
+      // have been copied.
+      const uint32_t offset = m_slots[i].offset;
+      const uint32_t length = m_slots[i].length;
+      m_slots[i].offset = DELETED;
+      m_size--;
+
+      auto& slot = get_slot(new_km);
+      make_tail(slot);
+      reserve_arena(length);
+      for (uint32_t j = offset; j < offset + length; j++)
+      {
+        m_arena.push_back(m_arena[j]);
+      }
+      slot.length += length;
+      m_dead += length;
+
+      compact_if_sparse();
+    }
+
+    // Remove a key-mask and its aliases
+    void erase(const RoutingTable::KeyMask& km)
+    {
+      auto i = find_slot(km);
+      if (i != NOT_FOUND)
+      {
+        m_dead += m_slots[i].length;
+        m_slots[i].offset = DELETED;
+        m_size--;
+        compact_if_sparse();
+      }
+    }
+
+    void clear()
+    {
+      for (auto& slot : m_slots)
+      {
+        slot.offset = EMPTY;
+      }
+      m_arena.clear();
+      m_size = m_used = m_dead = 0;
+    }
+
+  private:
+    // Markers stored in the offset of a slot
+    static const uint32_t EMPTY = 0xffffffff;
+    static const uint32_t DELETED = 0xfffffffe;
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    struct Slot
+    {
+      Slot() : keymask({0, 0}), offset(EMPTY), length(0) {}
+
+      RoutingTable::KeyMask keymask;
+      uint32_t offset;  // Start of the aliases in the arena (or a marker)
+      uint32_t length;  // Number of aliases
+    };
+
+    size_t find_slot(const RoutingTable::KeyMask& km) const
+    {
+      const size_t mask = m_slots.size() - 1;
+      for (size_t i = std::hash<RoutingTable::KeyMask>()(km) & mask; ;
+           i = (i + 1) & mask)
+      {
+        const auto& slot = m_slots[i];
+        if (slot.offset == EMPTY)
+        {
+          return NOT_FOUND;
+        }
+        else if (slot.offset != DELETED && slot.keymask == km)
+        {
+          return i;
+        }
+      }
+    }
+
+    // Get the slot for a key-mask, creating an empty slot if necessary
+    Slot& get_slot(const RoutingTable::KeyMask& km)
+    {
+      auto i = find_slot(km);
+      if (i != NOT_FOUND)
+      {
+        return m_slots[i];
+      }
+
+      // Keep the table no more than half full (including deleted slots)
+      if ((m_used + 1) * 2 > m_slots.size())
+      {
+        rehash(m_size * 4 > m_slots.size() ? m_slots.size() * 2
+                                           : m_slots.size());
+      }
+
+      // Use the first empty or deleted slot in the probe sequence
+      const size_t mask = m_slots.size() - 1;
+      i = std::hash<RoutingTable::KeyMask>()(km) & mask;
+      while (m_slots[i].offset < DELETED)
+      {
+        i = (i + 1) & mask;
+      }
+
+      auto& slot = m_slots[i];
+      if (slot.offset == EMPTY)
+      {
+        m_used++;
+      }
+      slot.keymask = km;
+      slot.offset = m_arena.size();
+      slot.length = 0;
+      m_size++;
+      return slot;
+    }
+
+    // Rebuild the slots with the given capacity, discarding deleted slots.
+    // The slots are rebuilt in a spare vector which is kept as large as the
+    // slots, so only growing the table allocates memory.
+    void rehash(size_t capacity)
+    {
+      m_spare_slots.assign(capacity, Slot());
+      m_spare_slots.swap(m_slots);
+      auto& old_slots = m_spare_slots;
+      m_used = m_size;
+
+      const size_t mask = m_slots.size() - 1;
+      for (const auto& slot : old_slots)
+      {
+        if (slot.offset < DELETED)
+        {
+          auto i = std::hash<RoutingTable::KeyMask>()(slot.keymask) & mask;
+          while (m_slots[i].offset != EMPTY)
+          {
+            i = (i + 1) & mask;
+          }
+          m_slots[i] = slot;
+        }
+      }
+      m_spare_slots.reserve(m_slots.size());
+    }
+
+    // Ensure that the aliases of a slot are at the end of the arena so that
+    // more may be appended.
+    void make_tail(Slot& slot)
+    {
+      if (slot.offset + slot.length != m_arena.size())
+      {
+        const uint32_t offset = slot.offset;
+        slot.offset = m_arena.size();
+        reserve_arena(slot.length);
+        for (uint32_t j = offset; j < offset + slot.length; j++)
+        {
+          m_arena.push_back(m_arena[j]);
+        }
+        m_dead += slot.length;
+      }
+    }
+
+    // Ensure that n aliases may be appended to the arena without it being
+    // reallocated, aliases are copied from within the arena as they are
+    // appended. The arena grows geometrically, as it would by push_back.
+    void reserve_arena(size_t n)
+    {
+      if (m_arena.size() + n > m_arena.capacity())
+      {
+        m_arena.reserve(std::max(m_arena.size() + n, m_arena.capacity() * 2));
+      }
+    }
+
+    // Remove unused aliases from the arena once they make up most of it
+    void compact_if_sparse()
+    {
+      if (m_dead * 2 <= m_arena.size())
+      {
+        return;
+      }
+
+      // Move the lists down the arena in order of their offsets, so that no
+      // list is overwritten before it has been moved, keeping the memory of
+      // the arena for later use.
+      m_live.clear();
+      for (uint32_t i = 0; i < m_slots.size(); i++)
+      {
+        if (m_slots[i].offset < DELETED)
+        {
+          m_live.push_back(i);
+        }
+      }
+      std::sort(m_live.begin(), m_live.end(),
+                [this] (uint32_t a, uint32_t b) {
+                  return m_slots[a].offset < m_slots[b].offset;
+                });
+
+      uint32_t end = 0;
+      for (auto i : m_live)
+      {
+        auto& slot = m_slots[i];
+        if (slot.offset != end)
+        {
+          std::copy(m_arena.begin() + slot.offset,
+                    m_arena.begin() + slot.offset + slot.length,
+                    m_arena.begin() + end);
+          slot.offset = end;
+        }
+        end += slot.length;
+      }
+      m_arena.resize(end);
+      m_dead = 0;
+    }
+
+    std::vector<Slot> m_slots;  // Open-addressed slots (power of two)
+    std::vector<Slot> m_spare_slots;  // Slots to rehash into
+    std::vector<RoutingTable::KeyMask> m_arena;  // Lists of aliases
+    std::vector<uint32_t> m_live;  // Live slots while compacting the arena
+    size_t m_size;  // Number of live slots
+    size_t m_used;  // Number of live and deleted slots
+    size_t m_dead;  // Number of unreferenced aliases in the arena
+};
+/*****************************************************************************/
+}
@@ -0,0 +1,43 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fixed_arena.h"
+#include "routing_entry.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Arena routing table *******************************************************/
+// A routing table held in an arena rather than on the heap, for use where
+// there is no heap, see BoundedCovering::minimise. Entries are laid out as in
+// a Table.
+typedef ArenaVector<Entry> ArenaTable;
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Layout-independent access *************************************************/
+inline KeyMask get_keymask(const ArenaTable& table, size_t i)
+{
+  return table[i].keymask;
+}
+
+inline uint32_t get_route(const ArenaTable& table, size_t i)
+{
+  return table[i].route;
+}
+
+inline Entry get_entry(const ArenaTable& table, size_t i)
+{
+  return table[i];
+}
+
+inline void set_entry(ArenaTable& table, size_t i, const Entry& entry)
+{
+  table[i] = entry;
+}
+/*****************************************************************************/
+
+}
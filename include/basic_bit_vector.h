@@ -0,0 +1,377 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Bit vector ****************************************************************/
+// A fixed-length vector of bits packed into 64-bit words. The number of set
+// bits is cached so that counting is constant time, and set bits may be
+// enumerated by skipping over empty words rather than testing every bit.
+//
+// The words are held in a std::vector<uint64_t> (see BitVector, in
+// bit_vector.h) or in any container with the same resize, size, back and
+// subscript methods, such as an ArenaVector; storage which cannot allocate
+// itself must be given enough capacity, through words(), before the vector is
+// resized.
+template <typename Words>
+class BasicBitVector
+{
+  public:
+    // Index returned by the find methods when there is no such bit
+    enum : size_t { npos = static_cast<size_t>(-1) };
+
+    // Proxy returned by the non-const subscript operator so that
+    // `merge[i] = true` continues to work as it did with std::vector<bool>.
+    class Reference
+    {
+      public:
+        Reference(BasicBitVector& vector, size_t index) :
+          m_vector(vector), m_index(index) {}
+
+        operator bool() const
+        {
+          return m_vector.test(m_index);
+        }
+
+        Reference& operator=(bool value)
+        {
+          m_vector.assign(m_index, value);
+          return *this;
+        }
+
+        Reference& operator=(const Reference& other)
+        {
+          return *this = static_cast<bool>(other);
+        }
+
+      private:
+        BasicBitVector& m_vector;
+        size_t m_index;
+    };
+
+    // Range over the indices of the set bits, in increasing order
+    class SetBits
+    {
+      public:
+        class Iterator
+        {
+          public:
+            Iterator(const BasicBitVector& vector, size_t index) :
+              m_vector(vector), m_index(index) {}
+
+            size_t operator*() const
+            {
+              return m_index;
+            }
+
+            Iterator& operator++()
+            {
+              m_index = m_vector.find_next(m_index);
+              return *this;
+            }
+
+            bool operator!=(const Iterator& other) const
+            {
+              return m_index != other.m_index;
+            }
+
+          private:
+            const BasicBitVector& m_vector;
+            size_t m_index;
+        };
+
+        explicit SetBits(const BasicBitVector& vector) : m_vector(vector) {}
+
+        Iterator begin() const
+        {
+          return Iterator(m_vector, m_vector.find_first());
+        }
+
+        Iterator end() const
+        {
+          return Iterator(m_vector, npos);
+        }
+
+      private:
+        const BasicBitVector& m_vector;
+    };
+
+    BasicBitVector() : m_size(0), m_count(0) {}
+
+    explicit BasicBitVector(size_t size, bool value=false) :
+      m_size(0), m_count(0)
+    {
+      resize(size, value);
+    }
+
+    BasicBitVector(std::initializer_list<bool> values) :
+      m_size(0), m_count(0)
+    {
+      resize(values.size());
+
+      size_t i = 0;
+      for (auto value : values)
+      {
+        assign(i++, value);
+      }
+    }
+
+    // Number of bits in the vector
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    // Number of set bits in the vector
+    size_t count() const
+    {
+      return m_count;
+    }
+
+    bool any() const
+    {
+      return m_count != 0;
+    }
+
+    bool none() const
+    {
+      return m_count == 0;
+    }
+
+    bool operator[](size_t i) const
+    {
+      return test(i);
+    }
+
+    Reference operator[](size_t i)
+    {
+      return Reference(*this, i);
+    }
+
+    bool test(size_t i) const
+    {
+      return (m_words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    void set(size_t i)
+    {
+      const uint64_t bit = ((uint64_t) 1) << (i & 63);
+      uint64_t& word = m_words[i >> 6];
+      m_count += !(word & bit);
+      word |= bit;
+    }
+
+    void reset(size_t i)
+    {
+      const uint64_t bit = ((uint64_t) 1) << (i & 63);
+      uint64_t& word = m_words[i >> 6];
+      m_count -= !!(word & bit);
+      word &= ~bit;
+    }
+
+    void assign(size_t i, bool value)
+    {
+      if (value)
+      {
+        set(i);
+      }
+      else
+      {
+        reset(i);
+      }
+    }
+
+    // Reset every bit, retaining the length of the vector
+    void clear()
+    {
+      for (auto& word : m_words)
+      {
+        word = 0;
+      }
+      m_count = 0;
+    }
+
+    // Change the number of bits in the vector, new bits take the given value
+    void resize(size_t size, bool value=false)
+    {
+      const size_t old_size = m_size;
+
+      // Drop any bits which are about to fall beyond the end of the vector
+      if (size < old_size)
+      {
+        m_size = size;
+        m_words.resize(n_words(size));
+        mask_tail();
+        recount();
+        return;
+      }
+
+      m_words.resize(n_words(size), value ? ~((uint64_t) 0) : 0);
+      m_size = size;
+
+      if (value)
+      {
+        // Set the bits in the last partially-used word of the old length
+        for (size_t i = old_size; i < size && (i & 63); i++)
+        {
+          m_words[i >> 6] |= ((uint64_t) 1) << (i & 63);
+        }
+        mask_tail();
+      }
+      recount();
+    }
+
+    // Index of the first set bit, or npos if no bits are set
+    size_t find_first() const
+    {
+      return find_from(0);
+    }
+
+    // Index of the first set bit after i, or npos if there is none
+    size_t find_next(size_t i) const
+    {
+      return find_from(i + 1);
+    }
+
+    // Index of the last set bit, or npos if no bits are set
+    size_t find_last() const
+    {
+      return m_size ? find_to(m_size - 1) : npos;
+    }
+
+    // Index of the last set bit before i, or npos if there is none
+    size_t find_prev(size_t i) const
+    {
+      return i ? find_to(i - 1) : npos;
+    }
+
+    SetBits set_bits() const
+    {
+      return SetBits(*this);
+    }
+
+    // Get the storage of the words
+    Words& words()
+    {
+      return m_words;
+    }
+
+    // Bitwise operations, the vectors must be of the same length
+    BasicBitVector& operator&=(const BasicBitVector& b)
+    {
+      for (size_t i = 0; i < m_words.size(); i++)
+      {
+        m_words[i] &= b.m_words[i];
+      }
+      recount();
+      return *this;
+    }
+
+    BasicBitVector& operator|=(const BasicBitVector& b)
+    {
+      for (size_t i = 0; i < m_words.size(); i++)
+      {
+        m_words[i] |= b.m_words[i];
+      }
+      recount();
+      return *this;
+    }
+
+    // Clear every bit which is set in b (a &= ~b)
+    BasicBitVector& and_not(const BasicBitVector& b)
+    {
+      for (size_t i = 0; i < m_words.size(); i++)
+      {
+        m_words[i] &= ~b.m_words[i];
+      }
+      recount();
+      return *this;
+    }
+
+    bool operator==(const BasicBitVector& b) const
+    {
+      return m_size == b.m_size && m_words == b.m_words;
+    }
+
+    bool operator!=(const BasicBitVector& b) const
+    {
+      return !(*this == b);
+    }
+
+  private:
+    static size_t n_words(size_t size)
+    {
+      return (size + 63) >> 6;
+    }
+
+    // Ensure bits beyond the end of the vector are never set
+    void mask_tail()
+    {
+      if (m_size & 63)
+      {
+        m_words.back() &= (((uint64_t) 1) << (m_size & 63)) - 1;
+      }
+    }
+
+    void recount()
+    {
+      m_count = 0;
+      for (auto word : m_words)
+      {
+        m_count += __builtin_popcountll(word);
+      }
+    }
+
+    size_t find_from(size_t i) const
+    {
+      if (i >= m_size)
+      {
+        return npos;
+      }
+
+      // Mask off the bits below i in the first word and then skip over any
+      // empty words.
+      size_t w = i >> 6;
+      uint64_t word = m_words[w] & (~((uint64_t) 0) << (i & 63));
+      while (!word)
+      {
+        if (++w == m_words.size())
+        {
+          return npos;
+        }
+        word = m_words[w];
+      }
+
+      return (w << 6) + __builtin_ctzll(word);
+    }
+
+    size_t find_to(size_t i) const
+    {
+      // Mask off the bits above i in the first word and then skip backwards
+      // over any empty words.
+      size_t w = i >> 6;
+      uint64_t word = m_words[w] & (~((uint64_t) 0) >> (63 - (i & 63)));
+      while (!word)
+      {
+        if (w-- == 0)
+        {
+          return npos;
+        }
+        word = m_words[w];
+      }
+
+      return (w << 6) + 63 - __builtin_clzll(word);
+    }
+
+    Words m_words;
+    size_t m_size;
+    size_t m_count;
+};
+/*****************************************************************************/
+
+}
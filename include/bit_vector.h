@@ -0,0 +1,16 @@
+#include <stdint.h>
+#include <vector>
+
+#include "basic_bit_vector.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Bit vector ****************************************************************/
+typedef BasicBitVector<std::vector<uint64_t>> BitVector;
+/*****************************************************************************/
+
+}
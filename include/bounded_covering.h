@@ -0,0 +1,409 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+
+#include "arena_table.h"
+#include "basic_bit_vector.h"
+#include "fixed_arena.h"
+#include "ordered_covering_core.h"
+#include "routing_entry.h"
+
+#pragma once
+
+namespace BoundedCovering
+{
+/*****************************************************************************/
+/* Bounded-memory Ordered Covering *******************************************/
+// The Ordered Covering algorithm of OrderedCovering::minimise, for use where
+// memory is fixed and there is no heap, such as on a SpiNNaker chip. Every
+// buffer is taken from an arena supplied by the caller and nothing is
+// allocated from the heap, the table itself is only ever shortened.
+//
+// Each merge is chosen and applied by the routines of OrderedCovering in
+// ordered_covering_core.h, given merges, aliases and route groups held in the
+// arena, so the same table is produced as by OrderedCovering::minimise given
+// an empty alias table. Nothing is cached between iterations, so each merge
+// costs a search of the whole table, but the route groups are updated as each
+// merge is applied rather than being found again.
+//
+// Minimising a table of n entries needs about 28n bytes of arena to start
+// with and another 16 bytes for each entry which is merged, to record the
+// aliases of the merged entries. If the arena is exhausted before a merge is
+// applied the table is left as it was after the previous merge and
+// OUT_OF_MEMORY is returned. The arena's allocations are released before
+// returning, its high-water mark records how much memory was needed.
+//
+// Tables are expected to be sorted in increasing generality and may be a
+// Table, a SoATable or an ArenaTable.
+template <typename T>
+OrderedCovering::Status minimise(T& table,
+                                 unsigned int target_length,
+                                 RoutingTable::Arena& arena);
+/*****************************************************************************/
+
+
+/*****************************************************************************/
+/* Storage held in an arena **************************************************/
+// A merge whose words are taken from an arena, see allocate_merge
+typedef RoutingTable::BasicBitVector<RoutingTable::ArenaVector<uint64_t>>
+  ArenaMerge;
+
+// The aliases of the entries of a table, as an OrderedCovering::AliasTable
+// but held in an arena as records sorted by the key-mask which owns them.
+// Every merged entry adds at most one record, so room for the entries of a
+// merge is reserved before it is applied.
+class ArenaAliasTable
+{
+  public:
+    // An alias: the key-mask of an entry which was replaced by the entry with
+    // the owner key-mask.
+    struct Record
+    {
+      RoutingTable::KeyMask owner;
+      RoutingTable::KeyMask alias;
+    };
+
+    // Contiguous list of the aliases of a key-mask
+    class Range
+    {
+      public:
+        class Iterator
+        {
+          public:
+            explicit Iterator(const Record* record) : m_record(record) {}
+
+            RoutingTable::KeyMask operator*() const
+            {
+              return m_record->alias;
+            }
+
+            Iterator& operator++()
+            {
+              m_record++;
+              return *this;
+            }
+
+            bool operator!=(const Iterator& other) const
+            {
+              return m_record != other.m_record;
+            }
+
+          private:
+            const Record* m_record;
+        };
+
+        Range(const Record* begin, const Record* end) :
+          m_begin(begin), m_end(end) {}
+
+        Iterator begin() const
+        {
+          return Iterator(m_begin);
+        }
+
+        Iterator end() const
+        {
+          return Iterator(m_end);
+        }
+
+        size_t size() const
+        {
+          return m_end - m_begin;
+        }
+
+        bool empty() const
+        {
+          return m_begin == m_end;
+        }
+
+      private:
+        const Record* m_begin;
+        const Record* m_end;
+    };
+
+    // Take storage from an arena, which must make no other allocation while
+    // the table is in use so that the storage may grow in place.
+    bool allocate(RoutingTable::Arena& arena)
+    {
+      return m_records.allocate(arena, 0);
+    }
+
+    // Make room for `size` records, returning false if there is not enough
+    bool reserve(size_t size)
+    {
+      return m_records.reserve(size);
+    }
+
+    // Number of aliases
+    size_t size() const
+    {
+      return m_records.size();
+    }
+
+    // Get the aliases of a key-mask, the range is empty if there are none.
+    // The range is invalidated by any modification of the table.
+    Range lookup(const RoutingTable::KeyMask& km) const
+    {
+      const auto range = std::equal_range(m_records.begin(), m_records.end(),
+                                          km, OwnerLess());
+      return Range(range.first, range.second);
+    }
+
+    // Replace old_km with new_km; if old_km has aliases then they are moved
+    // to new_km, otherwise old_km itself becomes an alias of new_km. There
+    // must be room for another record.
+    void replace(const RoutingTable::KeyMask& new_km,
+                 const RoutingTable::KeyMask& old_km)
+    {
+      const auto range = std::equal_range(m_records.begin(), m_records.end(),
+                                          old_km, OwnerLess());
+      if (range.first == range.second)
+      {
+        // Insert the new record after any others of the same owner
+        m_records.push_back({new_km, old_km});
+        const auto position = std::upper_bound(m_records.begin(),
+                                               m_records.end() - 1,
+                                               new_km, OwnerLess());
+        std::rotate(position, m_records.end() - 1, m_records.end());
+        return;
+      }
+
+      // Give the records to the new key-mask and move them, as a block, to
+      // where the records of the new key-mask belong.
+      for (auto record = range.first; record != range.second; record++)
+      {
+        record->owner = new_km;
+      }
+      if (new_km < old_km)
+      {
+        const auto position = std::upper_bound(m_records.begin(), range.first,
+                                               new_km, OwnerLess());
+        std::rotate(position, range.first, range.second);
+      }
+      else if (old_km < new_km)
+      {
+        const auto position = std::lower_bound(range.second, m_records.end(),
+                                               new_km, OwnerLess());
+        std::rotate(range.first, range.second, position);
+      }
+    }
+
+  private:
+    struct OwnerLess
+    {
+      bool operator()(const Record& a, const RoutingTable::KeyMask& km) const
+      {
+        return a.owner < km;
+      }
+
+      bool operator()(const RoutingTable::KeyMask& km, const Record& a) const
+      {
+        return km < a.owner;
+      }
+    };
+
+    RoutingTable::ArenaVector<Record> m_records;
+};
+/*****************************************************************************/
+
+
+/*****************************************************************************/
+/* Implementation ************************************************************/
+// A route group which may be merged, see OrderedCovering::Candidate
+struct Candidate
+{
+  int bound;           // One less than the number of entries in the group
+  unsigned int front;  // Position of the first entry of the group
+  unsigned int begin, end;  // Range of the group in the route order
+};
+
+// The buffers used while minimising a table, taken from the arena. The table
+// never grows so every buffer but the aliases is allocated once; the aliases
+// are allocated last so that they may be extended in place.
+struct Workspace
+{
+  // Positions of the entries of the table sorted by route and then position,
+  // so that each route group is contiguous and in increasing order.
+  RoutingTable::ArenaVector<unsigned int> order;
+  RoutingTable::ArenaVector<Candidate> candidates;  // Heap of route groups
+  RoutingTable::ArenaVector<unsigned int> new_index;  // See get_new_indices
+  ArenaMerge merge;    // Merge chosen in each iteration
+  ArenaMerge scratch;  // Candidate merges while they are refined
+  ArenaAliasTable aliases;
+};
+
+// Allocate the words of a merge of `size` entries and clear them
+inline bool allocate_merge(ArenaMerge& merge,
+                           RoutingTable::Arena& arena,
+                           unsigned int size)
+{
+  if (!merge.words().allocate(arena, (size + 63) / 64))
+  {
+    return false;
+  }
+  merge.resize(size);
+  return true;
+}
+
+inline bool allocate_workspace(Workspace& workspace,
+                               RoutingTable::Arena& arena,
+                               unsigned int size)
+{
+  return workspace.order.allocate(arena, size) &&
+         workspace.candidates.allocate(arena, size) &&
+         workspace.new_index.allocate(arena, size + 1) &&
+         allocate_merge(workspace.merge, arena, size) &&
+         allocate_merge(workspace.scratch, arena, size) &&
+         workspace.aliases.allocate(arena);
+}
+
+// Order of positions in a table by route and then by position
+template <typename T>
+struct RouteLess
+{
+  const T& table;
+
+  bool operator()(unsigned int a, unsigned int b) const
+  {
+    const auto route_a = get_route(table, a);
+    const auto route_b = get_route(table, b);
+    return route_a < route_b || (route_a == route_b && a < b);
+  }
+};
+
+// Sort the positions of the entries of a table into route order
+template <typename T>
+void get_route_order(const T& table,
+                     RoutingTable::ArenaVector<unsigned int>& order)
+{
+  order.resize(table.size());
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), RouteLess<T>{table});
+}
+
+// Fill a heap (ordered by OrderedCovering::LowerBound) with a candidate for
+// every route group, see OrderedCovering::get_candidates.
+template <typename T>
+void get_candidates(const T& table,
+                    const RoutingTable::ArenaVector<unsigned int>& order,
+                    RoutingTable::ArenaVector<Candidate>& candidates)
+{
+  candidates.clear();
+  const unsigned int size = order.size();
+  for (unsigned int begin = 0, end = 0; begin < size; begin = end)
+  {
+    const auto route = get_route(table, order[begin]);
+    while (end < size && get_route(table, order[end]) == route)
+    {
+      end++;
+    }
+    candidates.push_back({(int) (end - begin) - 1, order[begin], begin, end});
+  }
+  std::make_heap(candidates.begin(), candidates.end(),
+                 OrderedCovering::LowerBound());
+}
+
+// Apply the chosen merge to the table, its generality index, its aliases and
+// its route order. Room for the aliases must already have been reserved.
+template <typename T>
+void merge_apply(T& table,
+                 OrderedCovering::GeneralityIndex& generality,
+                 Workspace& workspace)
+{
+  const auto& merge = workspace.merge;
+  const auto merge_entry = OrderedCovering::merge_entries(table, merge);
+  const unsigned int insertion_point =
+    OrderedCovering::get_insertion_offset(generality, merge_entry);
+
+  // Drop the merged entries from the route order and move the others to
+  // their new positions, which keeps every group in order.
+  auto& order = workspace.order;
+  auto& new_index = workspace.new_index;
+  OrderedCovering::get_new_indices(merge, insertion_point, new_index);
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < order.size(); i++)
+  {
+    if (!merge[order[i]])
+    {
+      order[kept++] = new_index[order[i]];
+    }
+  }
+  order.resize(kept);
+
+  // The new entry precedes every entry which was at or below the insertion
+  // point, see OrderedCovering::route_index_apply.
+  const unsigned int index = new_index[insertion_point] - 1;
+  OrderedCovering::merge_apply(table, generality, workspace.aliases, merge);
+
+  // Add the new entry to the group of its route
+  const auto position = std::lower_bound(order.begin(), order.end(), index,
+                                         RouteLess<T>{table});
+  order.push_back(index);
+  std::rotate(position, order.end() - 1, order.end());
+}
+
+template <typename T>
+OrderedCovering::Status minimise(T& table,
+                                 unsigned int target_length,
+                                 Workspace& workspace)
+{
+  auto generality = OrderedCovering::get_generality_index(table);
+  get_route_order(table, workspace.order);
+
+  const auto& order = workspace.order;
+  auto set_members = [&order] (const Candidate& candidate, ArenaMerge& merge)
+  {
+    for (unsigned int i = candidate.begin; i < candidate.end; i++)
+    {
+      merge.set(order[i]);
+    }
+  };
+
+  while (table.size() > target_length)
+  {
+    workspace.merge.resize(table.size());
+    workspace.scratch.resize(table.size());
+    get_candidates(table, order, workspace.candidates);
+    if (OrderedCovering::select_best_merge(table, generality,
+                                           workspace.aliases,
+                                           workspace.candidates,
+                                           workspace.merge,
+                                           workspace.scratch,
+                                           set_members) < 1)
+    {
+      return OrderedCovering::NO_MERGES;
+    }
+
+    // Each merged entry adds at most one alias
+    if (!workspace.aliases.reserve(workspace.aliases.size() +
+                                   workspace.merge.count()))
+    {
+      return OrderedCovering::OUT_OF_MEMORY;
+    }
+    merge_apply(table, generality, workspace);
+  }
+
+  return OrderedCovering::TARGET_MET;
+}
+
+template <typename T>
+OrderedCovering::Status minimise(T& table,
+                                 unsigned int target_length,
+                                 RoutingTable::Arena& arena)
+{
+  const size_t mark = arena.mark();
+  auto status = OrderedCovering::OUT_OF_MEMORY;
+
+  Workspace workspace;
+  if (allocate_workspace(workspace, arena, table.size()))
+  {
+    status = minimise(table, target_length, workspace);
+  }
+
+  arena.release(mark);
+  return status;
+}
+/*****************************************************************************/
+}
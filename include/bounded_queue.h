@@ -0,0 +1,118 @@
+#include <stddef.h>
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#pragma once
+
+namespace Parallel
+{
+
+/*****************************************************************************/
+/* Bounded queue *************************************************************/
+// A blocking queue holding at most `capacity` items for connecting the stages
+// of a pipeline. Items are removed highest priority first according to
+// Compare, as with std::priority_queue. Once the queue is closed no more items
+// may be pushed and pop returns false as soon as the queue is empty.
+template <typename T, typename Compare = std::less<T>>
+class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity, Compare compare = Compare()) :
+      m_capacity(capacity ? capacity : 1), m_compare(compare), m_closed(false)
+    {
+    }
+
+    // Add an item, waiting for space if the queue is full. Returns false (and
+    // discards the item) if the queue has been closed.
+    bool push(T item)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_full.wait(lock, [this] () {
+        return m_closed || m_items.size() < m_capacity;
+      });
+      if (m_closed)
+      {
+        return false;
+      }
+
+      m_items.push_back(std::move(item));
+      std::push_heap(m_items.begin(), m_items.end(), m_compare);
+      m_not_empty.notify_one();
+      return true;
+    }
+
+    // Remove the highest priority item, waiting for one if the queue is
+    // empty. Returns false if the queue is closed and empty.
+    bool pop(T& item)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait(lock, [this] () {
+        return m_closed || !m_items.empty();
+      });
+      if (m_items.empty())
+      {
+        return false;
+      }
+
+      std::pop_heap(m_items.begin(), m_items.end(), m_compare);
+      item = std::move(m_items.back());
+      m_items.pop_back();
+      m_not_full.notify_one();
+      return true;
+    }
+
+    // Prevent any further items from being pushed and wake every waiter
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+      m_not_empty.notify_all();
+      m_not_full.notify_all();
+    }
+
+  private:
+    const size_t m_capacity;
+    Compare m_compare;
+
+    std::mutex m_mutex;  // Guards the following
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::vector<T> m_items;  // Heap ordered by m_compare
+    bool m_closed;
+};
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Counting semaphore ********************************************************/
+// Used to limit the number of items in flight across several pipeline stages.
+class Semaphore
+{
+  public:
+    explicit Semaphore(size_t count) : m_count(count) {}
+
+    void acquire()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_available.wait(lock, [this] () { return m_count > 0; });
+      m_count--;
+    }
+
+    void release()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_count++;
+      m_available.notify_one();
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    size_t m_count;
+};
+/*****************************************************************************/
+
+}
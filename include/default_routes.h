@@ -1,5 +1,11 @@
 #include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "intersect.h"
+#include "keymask_trie.h"
 #include "routing_table.h"
+#include "soa_table.h"
+#include "work_stealing_pool.h"
 
 #pragma once
 
@@ -9,15 +15,11 @@ using RoutingTable::Table;
 namespace DefaultRoutes
 {
 
-// Determine if an entry may be replaced by default routing.
-bool defaultable(const Table& table, const Table::const_iterator p_entry)
+// Determine if packets matching an entry go straight through the router,
+// arriving by one link and leaving by the opposite link, as they would if they
+// were default routed.
+inline bool passes_through(const RoutingTable::Entry& entry)
 {
-  // An entry may be replaced by default routing iff. packets arrive at the
-  // router through 1 link and exit by the opposing link (they go straight
-  // through) AND there are no other entries lower in the table which would
-  // match any of the same packets.
-  auto entry = *p_entry;
-
   // If either the source or the route contain any cores the entry may not
   // be replaced by a default route.
   if ((entry.source & 0xffffffc0) || (entry.route & 0xffffffc0))
@@ -25,85 +27,150 @@ bool defaultable(const Table& table, const Table::const_iterator p_entry)
     return false;
   }
 
-  // If the out-route is not opposite to the in-route then the entry cannot be
-  // replaced by a default route.
+  // There must be exactly one way that packets can arrive, and the out-route
+  // must be opposite to it (and so also a single link).
   auto opp_source = ((entry.source << 3) & 0x38) | ((entry.source >> 3) & 0x7);
-  if (opp_source != entry.route)
+  return __builtin_popcount(entry.source) == 1 && opp_source == entry.route;
+}
+
+// Determine if an entry may be replaced by default routing. Tables may be
+// either a Table or a SoATable.
+template <typename T>
+bool defaultable(const T& table, const unsigned int index)
+{
+  // An entry may be replaced by default routing iff. packets go straight
+  // through the router AND there are no other entries lower in the table which
+  // would match any of the same packets.
+  if (!passes_through(get_entry(table, index)))
   {
     return false;
   }
 
-  // If there is more than one way that packets can arrive or leave the router
-  // according to this route then the entry cannot be replaced by a default
-  // route.
-  unsigned int count_in = 0;
-  for (unsigned int i = 0; i < 6; i++)
+  // If the entry intersects at all with any entry lower in the table then it
+  // cannot be replaced by a default route.
+  return Intersect::find_first(table, index + 1, table.size(),
+                               get_keymask(table, index)) == table.size();
+}
+
+inline bool defaultable(const Table& table,
+                        const Table::const_iterator p_entry)
+{
+  return defaultable(table, (unsigned int) (p_entry - table.begin()));
+}
+
+/*****************************************************************************/
+// Mark the entries of table[begin, end) which may be replaced by default
+// routing, `below` indexes the key-masks of every entry after `end`. The range
+// is swept from the bottom up, indexing the key-masks seen so far, so that
+// each entry is checked only against key-masks sharing a prefix with its own.
+template <typename T>
+void find_defaultable(const T& table,
+                      unsigned int begin,
+                      unsigned int end,
+                      const std::vector<const RoutingTable::KeyMaskTrie*>& below,
+                      std::vector<char>& defaultable)
+{
+  auto seen = RoutingTable::KeyMaskTrie();
+  for (unsigned int i = end; i-- > begin; )
   {
-    if (entry.source & (1 << i))
+    const auto km = get_keymask(table, i);
+    if (passes_through(get_entry(table, i)))
     {
-      count_in++;
+      defaultable[i] = !seen.any_intersecting(km) &&
+        std::none_of(below.begin(), below.end(), [&km] (auto trie) {
+          return trie->any_intersecting(km);
+        });
     }
+    seen.insert(km, i);
   }
+}
 
-  unsigned int count_out = 0;
-  for (unsigned int i = 0; i < 6; i++)
+// Remove the marked entries from a table, keeping the order of the rest
+template <typename T>
+void remove_defaultable(T& table, const std::vector<char>& defaultable)
+{
+  unsigned int insert = 0;
+  for (unsigned int remove = 0; remove < table.size(); remove++)
   {
-    if (entry.route & (1 << i))
+    if (!defaultable[remove])
     {
-      count_out++;
+      set_entry(table, insert++, get_entry(table, remove));
     }
   }
 
-  if (count_in != 1 || count_out != 1)
-  {
-    return false;
-  }
+  // Shrink the table to account for removed elements
+  table.resize(insert);
+}
 
-  // If the entry intersects at all with any entry lower in the table then it
-  // cannot be replaced by a default route.
-  for (auto other_entry = p_entry + 1;
-       other_entry != table.end();
-       other_entry++)
+// Minimise a table by removing entries which could be handled by default
+// routing.
+template <typename T>
+void minimise(T& table)
+{
+  auto remove = std::vector<char>(table.size(), false);
+  if (table.size() < 1024)
   {
-    auto other_km = (*other_entry).keymask;
-    if (other_km.intersect(entry.keymask))
+    // Small tables are quicker to scan than to index
+    for (unsigned int i = 0; i < table.size(); i++)
     {
-      return false;
+      remove[i] = defaultable(table, i);
     }
   }
-
-  return true;
+  else
+  {
+    find_defaultable(table, 0, table.size(), {}, remove);
+  }
+  remove_defaultable(table, remove);
 }
 
-/*****************************************************************************/
-// Minimise a table by removing entries which could be handled by default
-// routing.
-void minimise(Table& table)
+// As above, but splitting large tables into blocks which are checked
+// concurrently on a pool of workers. The result is identical to the serial
+// form.
+template <typename T>
+void minimise(T& table, Parallel::WorkStealingPool& pool)
 {
-  auto final_size = table.size();  // Length of finished table
+  // Blocks smaller than this are not worth sharing out
+  const unsigned int min_block = 4096;
+  const unsigned int n_blocks = std::max(1u, std::min(
+    pool.size(), (unsigned int) table.size() / min_block
+  ));
+  auto bounds = std::vector<unsigned int>(n_blocks + 1);
+  for (unsigned int b = 0; b <= n_blocks; b++)
+  {
+    bounds[b] = (unsigned int) ((uint64_t) table.size() * b / n_blocks);
+  }
 
-  // Iterate through the table removing any entries which could be managed by
-  // default routing.
-  auto insert = table.begin();
-  for (auto remove = table.begin(); remove != table.end(); remove++)
+  // Index the key-masks of every block but the first, each block is then
+  // swept as in the serial form while also checking the blocks below it.
+  auto tries = std::vector<RoutingTable::KeyMaskTrie>(n_blocks);
+  auto tasks = std::vector<unsigned int>();
+  for (unsigned int b = 1; b < n_blocks; b++)
+  {
+    tasks.push_back(b);
+  }
+  pool.run(tasks, [&] (unsigned int b)
   {
-    if (!defaultable(table, remove))
+    for (unsigned int i = bounds[b]; i < bounds[b + 1]; i++)
     {
-      // If this entry could not be replaced by a default entry then insert it
-      // into the table.
-      *insert = *remove;
-      insert++;
+      tries[b].insert(get_keymask(table, i), i);
     }
-    else
+  });
+
+  // The highest blocks are checked against the most tries so start them
+  // first.
+  auto defaultable = std::vector<char>(table.size(), false);
+  tasks.insert(tasks.begin(), 0);
+  pool.run(tasks, [&] (unsigned int b)
+  {
+    auto below = std::vector<const RoutingTable::KeyMaskTrie*>();
+    for (unsigned int c = b + 1; c < n_blocks; c++)
     {
-      // Otherwise don't include this entry and instead decrement the final
-      // table size.
-      final_size--;
+      below.push_back(&tries[c]);
     }
-  }
+    find_defaultable(table, bounds[b], bounds[b + 1], below, defaultable);
+  });
 
-  // Shrink the table to account for removed elements
-  table.resize(final_size);
+  remove_defaultable(table, defaultable);
 }
 /*****************************************************************************/
 }
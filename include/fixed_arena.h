@@ -0,0 +1,316 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Fixed arena ***************************************************************/
+// A bump allocator over a fixed block of memory supplied by its owner, for
+// code which must run within a known memory budget and may not use the heap.
+// Allocations are released together, either back to a mark or entirely, and
+// the most recent allocation may be extended in place. An allocation which
+// does not fit returns nullptr rather than throwing so that the caller may
+// stop cleanly. The largest amount of memory ever in use is recorded.
+class Arena
+{
+  public:
+    // Every allocation is aligned to this many bytes
+    enum : size_t { ALIGNMENT = 8 };
+
+    Arena(void* data, size_t capacity) :
+      m_data((unsigned char*) data), m_capacity(capacity), m_used(0),
+      m_last(0), m_high_water(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Allocate bytes, returning nullptr if there is not enough space
+    void* allocate(size_t size)
+    {
+      const size_t start = align(m_used);
+      if (start > m_capacity || size > m_capacity - start)
+      {
+        return nullptr;
+      }
+
+      m_last = start;
+      set_used(start + size);
+      return m_data + start;
+    }
+
+    // Allocate an uninitialised array of `n` objects
+    template <typename T>
+    T* allocate(size_t n)
+    {
+      if (n > m_capacity / sizeof(T))
+      {
+        return nullptr;
+      }
+      return (T*) allocate(n * sizeof(T));
+    }
+
+    // Extend the most recent allocation to `n` objects, returning false
+    // (and leaving the allocation unchanged) if there is not enough space or
+    // `p` was not the most recent allocation.
+    template <typename T>
+    bool extend(const T* p, size_t n)
+    {
+      if ((const unsigned char*) p != m_data + m_last ||
+          n > (m_capacity - m_last) / sizeof(T))
+      {
+        return false;
+      }
+
+      set_used(m_last + n * sizeof(T));
+      return true;
+    }
+
+    // Get the amount in use, which may be passed to release to free every
+    // allocation made after this point.
+    size_t mark() const
+    {
+      return m_used;
+    }
+
+    void release(size_t mark)
+    {
+      m_used = mark;
+      m_last = mark;
+    }
+
+    // Free every allocation; the high-water mark is kept
+    void clear()
+    {
+      release(0);
+    }
+
+    size_t capacity() const
+    {
+      return m_capacity;
+    }
+
+    // Bytes currently allocated
+    size_t used() const
+    {
+      return m_used;
+    }
+
+    // Most bytes ever allocated at once
+    size_t high_water() const
+    {
+      return m_high_water;
+    }
+
+    // Start recording the high-water mark afresh from the amount in use
+    void reset_high_water()
+    {
+      m_high_water = m_used;
+    }
+
+  private:
+    static size_t align(size_t offset)
+    {
+      return (offset + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1);
+    }
+
+    void set_used(size_t used)
+    {
+      m_used = used;
+      if (m_used > m_high_water)
+      {
+        m_high_water = m_used;
+      }
+    }
+
+    unsigned char* m_data;
+    size_t m_capacity;
+    size_t m_used;        // Bytes allocated, including alignment padding
+    size_t m_last;        // Offset of the most recent allocation
+    size_t m_high_water;  // Most bytes ever allocated
+};
+
+// An arena holding its own memory, of a capacity fixed at compile time
+template <size_t Capacity>
+class FixedArena : public Arena
+{
+  public:
+    FixedArena() : Arena(m_storage, Capacity) {}
+
+  private:
+    alignas(Arena::ALIGNMENT) unsigned char m_storage[Capacity];
+};
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Arena vector **************************************************************/
+// A vector of trivially copyable objects held in an arena, with the methods
+// of std::vector used by the minimisers. Its capacity is set when its storage
+// is allocated and it never allocates by itself: growing beyond the capacity
+// is an error. The capacity may be increased in place while the storage is
+// the most recent allocation of its arena.
+template <typename T>
+class ArenaVector
+{
+  public:
+    ArenaVector() :
+      m_arena(nullptr), m_data(nullptr), m_size(0), m_capacity(0) {}
+
+    // The storage belongs to the arena, so may not be shared by copying
+    ArenaVector(const ArenaVector&) = delete;
+
+    // Copy the elements of another vector, which must fit
+    ArenaVector& operator=(const ArenaVector& other)
+    {
+      resize(other.size());
+      for (size_t i = 0; i < m_size; i++)
+      {
+        m_data[i] = other[i];
+      }
+      return *this;
+    }
+
+    // Allocate storage for `capacity` objects, returning false (and leaving
+    // the vector without storage) if there is not enough space.
+    bool allocate(Arena& arena, size_t capacity)
+    {
+      m_arena = &arena;
+      m_data = arena.allocate<T>(capacity);
+      m_size = 0;
+      m_capacity = m_data ? capacity : 0;
+      return m_data != nullptr;
+    }
+
+    // Increase the capacity, returning false if there is not enough space or
+    // the storage is no longer the most recent allocation of its arena.
+    bool reserve(size_t capacity)
+    {
+      if (capacity <= m_capacity)
+      {
+        return true;
+      }
+      if (!m_data || !m_arena->extend(m_data, capacity))
+      {
+        return false;
+      }
+      m_capacity = capacity;
+      return true;
+    }
+
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    size_t capacity() const
+    {
+      return m_capacity;
+    }
+
+    bool empty() const
+    {
+      return m_size == 0;
+    }
+
+    T* data()
+    {
+      return m_data;
+    }
+
+    const T* data() const
+    {
+      return m_data;
+    }
+
+    T* begin()
+    {
+      return m_data;
+    }
+
+    const T* begin() const
+    {
+      return m_data;
+    }
+
+    T* end()
+    {
+      return m_data + m_size;
+    }
+
+    const T* end() const
+    {
+      return m_data + m_size;
+    }
+
+    T& operator[](size_t i)
+    {
+      return m_data[i];
+    }
+
+    const T& operator[](size_t i) const
+    {
+      return m_data[i];
+    }
+
+    T& back()
+    {
+      return m_data[m_size - 1];
+    }
+
+    const T& back() const
+    {
+      return m_data[m_size - 1];
+    }
+
+    void push_back(const T& value)
+    {
+      m_data[m_size++] = value;
+    }
+
+    void pop_back()
+    {
+      m_size--;
+    }
+
+    void clear()
+    {
+      m_size = 0;
+    }
+
+    // Change the number of objects, which may not exceed the capacity
+    void resize(size_t size, const T& value = T())
+    {
+      for (size_t i = m_size; i < size; i++)
+      {
+        m_data[i] = value;
+      }
+      m_size = size;
+    }
+
+    bool operator==(const ArenaVector& other) const
+    {
+      if (m_size != other.m_size)
+      {
+        return false;
+      }
+      for (size_t i = 0; i < m_size; i++)
+      {
+        if (!(m_data[i] == other.m_data[i]))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    Arena* m_arena;
+    T* m_data;
+    size_t m_size;
+    size_t m_capacity;
+};
+/*****************************************************************************/
+
+}
@@ -0,0 +1,188 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "intersect.h"
+#include "keymask_trie.h"
+#include "routing_table.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Indexed table *************************************************************/
+// A table (either a Table or a SoATable) along with a trie of the key-masks of
+// its entries, keyed by their positions in the table. Intersection queries
+// over long ranges of an indexed table are answered using the trie and so
+// cost roughly the number of intersecting key-masks rather than the length of
+// the range.
+//
+// The trie must be kept up to date by anything which modifies the table, see
+// OrderedCovering::merge_apply.
+//
+// The trie, and the buffer in which the results of queries are sorted, may
+// be supplied by the caller so that they are reused between tables rather
+// than allocated for each. A table with a supplied buffer may only be queried
+// by one thread at a time.
+template <typename T>
+class IndexedTable
+{
+  public:
+    explicit IndexedTable(T& table) :
+      m_table(table), m_owned(new KeyMaskTrie()), m_keymasks(m_owned.get()),
+      m_hits(nullptr)
+    {
+      index();
+    }
+
+    IndexedTable(T& table,
+                 KeyMaskTrie& keymasks,
+                 std::vector<unsigned int>& hits) :
+      m_table(table), m_keymasks(&keymasks), m_hits(&hits)
+    {
+      m_keymasks->clear();
+      index();
+    }
+
+    size_t size() const
+    {
+      return m_table.size();
+    }
+
+    T& table()
+    {
+      return m_table;
+    }
+
+    const T& table() const
+    {
+      return m_table;
+    }
+
+    KeyMaskTrie& keymasks()
+    {
+      return *m_keymasks;
+    }
+
+    const KeyMaskTrie& keymasks() const
+    {
+      return *m_keymasks;
+    }
+
+    // Get the buffer supplied for sorting query results, if any
+    std::vector<unsigned int>* hits() const
+    {
+      return m_hits;
+    }
+
+  private:
+    void index()
+    {
+      for (unsigned int i = 0; i < m_table.size(); i++)
+      {
+        m_keymasks->insert(get_keymask(m_table, i), i);
+      }
+    }
+
+    T& m_table;
+    std::unique_ptr<KeyMaskTrie> m_owned;  // The trie, unless supplied
+    KeyMaskTrie* m_keymasks;
+    std::vector<unsigned int>* m_hits;
+};
+
+template <typename T>
+KeyMask get_keymask(const IndexedTable<T>& table, size_t i)
+{
+  return get_keymask(table.table(), i);
+}
+
+template <typename T>
+uint32_t get_route(const IndexedTable<T>& table, size_t i)
+{
+  return get_route(table.table(), i);
+}
+
+template <typename T>
+Entry get_entry(const IndexedTable<T>& table, size_t i)
+{
+  return get_entry(table.table(), i);
+}
+/*****************************************************************************/
+
+}
+
+namespace Intersect
+{
+/*****************************************************************************/
+/* Range queries on indexed tables *******************************************/
+// Ranges shorter than this are quicker to scan than to look up in the trie
+const unsigned int INDEXED_SCAN_LENGTH = 16 * BLOCK;
+
+// Queries of ranges long enough to be worth looking up in the trie are
+// answered from it, see RangeQuery.
+template <typename T>
+struct RangeQuery<RoutingTable::IndexedTable<T>>
+{
+  static unsigned int find_first(const RoutingTable::IndexedTable<T>& table,
+                                 unsigned int begin,
+                                 unsigned int end,
+                                 const RoutingTable::KeyMask km,
+                                 unsigned int& tests)
+  {
+    if (end <= begin || end - begin <= INDEXED_SCAN_LENGTH)
+    {
+      return Intersect::find_first(table.table(), begin, end, km, tests);
+    }
+
+    unsigned int first = end;
+    table.keymasks().for_each_intersecting(km, begin, end,
+      [&first] (const RoutingTable::KeyMask&, unsigned int i)
+      {
+        first = std::min(first, i);
+        return true;
+      },
+      tests
+    );
+    return first;
+  }
+
+  template <typename F>
+  static void for_each(const RoutingTable::IndexedTable<T>& table,
+                       unsigned int begin,
+                       unsigned int end,
+                       const RoutingTable::KeyMask km,
+                       F f,
+                       unsigned int& tests)
+  {
+    if (end <= begin || end - begin <= INDEXED_SCAN_LENGTH)
+    {
+      Intersect::for_each(table.table(), begin, end, km, f, tests);
+      return;
+    }
+
+    // The trie visits key-masks in no particular order so sort the hits into
+    // increasing order, as for a scan.
+    auto local_hits = std::vector<unsigned int>();
+    auto& hits = table.hits() ? *table.hits() : local_hits;
+    hits.clear();
+    table.keymasks().for_each_intersecting(km, begin, end,
+      [&hits] (const RoutingTable::KeyMask&, unsigned int i)
+      {
+        hits.push_back(i);
+        return true;
+      },
+      tests
+    );
+    std::sort(hits.begin(), hits.end());
+    for (auto i : hits)
+    {
+      f(i);
+    }
+  }
+};
+/*****************************************************************************/
+}
@@ -0,0 +1,431 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RIG_INTERSECT_X86
+#endif
+
+#include "routing_entry.h"
+
+#pragma once
+
+namespace Intersect
+{
+/*****************************************************************************/
+/* Vectorised key-mask intersection ******************************************/
+// Kernels which test a block of up to 64 consecutive entries against a single
+// key-mask and return a bitmap of the entries which intersect it (bit i is set
+// if entry i intersects). The widest kernel supported by the processor is
+// selected at runtime.
+typedef uint64_t (*Kernel)(const RoutingTable::Entry* entries,
+                           unsigned int n,
+                           const RoutingTable::KeyMask km);
+
+// Number of entries tested by each call to a kernel
+const unsigned int BLOCK = 64;
+
+// Portable implementation, one entry at a time
+inline uint64_t intersect_scalar(const RoutingTable::Entry* entries,
+                                 unsigned int n,
+                                 const RoutingTable::KeyMask km)
+{
+  uint64_t hits = 0;
+  for (unsigned int i = 0; i < n; i++)
+  {
+    hits |= ((uint64_t) entries[i].keymask.intersect(km)) << i;
+  }
+  return hits;
+}
+
+#ifdef RIG_INTERSECT_X86
+// Four entries at a time: the keys and masks are separated from the source
+// and route fields with a 4x4 transpose.
+__attribute__((target("sse2")))
+inline uint64_t intersect_sse2(const RoutingTable::Entry* entries,
+                               unsigned int n,
+                               const RoutingTable::KeyMask km)
+{
+  const __m128i key = _mm_set1_epi32(km.key);
+  const __m128i mask = _mm_set1_epi32(km.mask);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128i* p = (const __m128i*) (entries + i);
+    const __m128i t0 = _mm_unpacklo_epi32(_mm_loadu_si128(p),
+                                          _mm_loadu_si128(p + 1));
+    const __m128i t1 = _mm_unpacklo_epi32(_mm_loadu_si128(p + 2),
+                                          _mm_loadu_si128(p + 3));
+    const __m128i keys = _mm_unpacklo_epi64(t0, t1);   // k0 k1 k2 k3
+    const __m128i masks = _mm_unpackhi_epi64(t0, t1);  // m0 m1 m2 m3
+
+    const __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(keys, mask),
+                                       _mm_and_si128(masks, key));
+    hits |= ((uint64_t) _mm_movemask_ps(_mm_castsi128_ps(eq))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_scalar(entries + i, n - i, km) << i;
+  }
+  return hits;
+}
+
+// Eight entries at a time, the transpose leaves the entries interleaved
+// across the two 128-bit lanes so the result is permuted back into order.
+__attribute__((target("avx2")))
+inline uint64_t intersect_avx2(const RoutingTable::Entry* entries,
+                               unsigned int n,
+                               const RoutingTable::KeyMask km)
+{
+  const __m256i key = _mm256_set1_epi32(km.key);
+  const __m256i mask = _mm256_set1_epi32(km.mask);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256i* p = (const __m256i*) (entries + i);
+    const __m256i t0 = _mm256_unpacklo_epi32(_mm256_loadu_si256(p),
+                                             _mm256_loadu_si256(p + 1));
+    const __m256i t1 = _mm256_unpacklo_epi32(_mm256_loadu_si256(p + 2),
+                                             _mm256_loadu_si256(p + 3));
+    const __m256i keys = _mm256_unpacklo_epi64(t0, t1);   // k0 k2 k4 k6 ...
+    const __m256i masks = _mm256_unpackhi_epi64(t0, t1);  // m0 m2 m4 m6 ...
+
+    const __m256i eq = _mm256_permutevar8x32_epi32(
+      _mm256_cmpeq_epi32(_mm256_and_si256(keys, mask),
+                         _mm256_and_si256(masks, key)),
+      order
+    );
+    hits |= ((uint64_t) _mm256_movemask_ps(_mm256_castsi256_ps(eq))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_sse2(entries + i, n - i, km) << i;
+  }
+  return hits;
+}
+
+// Sixteen entries at a time, using two-source permutes to gather the keys and
+// masks in order.
+__attribute__((target("avx512f")))
+inline uint64_t intersect_avx512(const RoutingTable::Entry* entries,
+                                 unsigned int n,
+                                 const RoutingTable::KeyMask km)
+{
+  const __m512i key = _mm512_set1_epi32(km.key);
+  const __m512i mask = _mm512_set1_epi32(km.mask);
+
+  // Select the keys and then the masks of eight entries from two registers
+  const __m512i split = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28,
+                                          1, 5, 9, 13, 17, 21, 25, 29);
+  const __m512i lo = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                       16, 17, 18, 19, 20, 21, 22, 23);
+  const __m512i hi = _mm512_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15,
+                                       24, 25, 26, 27, 28, 29, 30, 31);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    const int* p = (const int*) (entries + i);
+    const __m512i a = _mm512_permutex2var_epi32(
+      _mm512_loadu_si512(p), split, _mm512_loadu_si512(p + 16));
+    const __m512i b = _mm512_permutex2var_epi32(
+      _mm512_loadu_si512(p + 32), split, _mm512_loadu_si512(p + 48));
+    const __m512i keys = _mm512_permutex2var_epi32(a, lo, b);
+    const __m512i masks = _mm512_permutex2var_epi32(a, hi, b);
+
+    hits |= ((uint64_t) _mm512_cmpeq_epi32_mask(
+      _mm512_and_si512(keys, mask), _mm512_and_si512(masks, key))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_avx2(entries + i, n - i, km) << i;
+  }
+  return hits;
+}
+#endif
+
+// Select the widest kernel the processor supports
+inline Kernel select_kernel()
+{
+#ifdef RIG_INTERSECT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return intersect_avx512;
+  }
+  else if (__builtin_cpu_supports("avx2"))
+  {
+    return intersect_avx2;
+  }
+  else if (__builtin_cpu_supports("sse2"))
+  {
+    return intersect_sse2;
+  }
+#endif
+  return intersect_scalar;
+}
+
+inline Kernel get_kernel()
+{
+  static const Kernel kernel = select_kernel();
+  return kernel;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Structure-of-arrays kernels ***********************************************/
+// As above but for tables with separate key and mask arrays, the keys and
+// masks are loaded directly without a transpose.
+typedef uint64_t (*SoAKernel)(const uint32_t* keys,
+                              const uint32_t* masks,
+                              unsigned int n,
+                              const RoutingTable::KeyMask km);
+
+inline uint64_t intersect_soa_scalar(const uint32_t* keys,
+                                     const uint32_t* masks,
+                                     unsigned int n,
+                                     const RoutingTable::KeyMask km)
+{
+  uint64_t hits = 0;
+  for (unsigned int i = 0; i < n; i++)
+  {
+    hits |= ((uint64_t) ((keys[i] & km.mask) == (km.key & masks[i]))) << i;
+  }
+  return hits;
+}
+
+#ifdef RIG_INTERSECT_X86
+__attribute__((target("sse2")))
+inline uint64_t intersect_soa_sse2(const uint32_t* keys,
+                                   const uint32_t* masks,
+                                   unsigned int n,
+                                   const RoutingTable::KeyMask km)
+{
+  const __m128i key = _mm_set1_epi32(km.key);
+  const __m128i mask = _mm_set1_epi32(km.mask);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128i eq = _mm_cmpeq_epi32(
+      _mm_and_si128(_mm_loadu_si128((const __m128i*) (keys + i)), mask),
+      _mm_and_si128(_mm_loadu_si128((const __m128i*) (masks + i)), key)
+    );
+    hits |= ((uint64_t) _mm_movemask_ps(_mm_castsi128_ps(eq))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_soa_scalar(keys + i, masks + i, n - i, km) << i;
+  }
+  return hits;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t intersect_soa_avx2(const uint32_t* keys,
+                                   const uint32_t* masks,
+                                   unsigned int n,
+                                   const RoutingTable::KeyMask km)
+{
+  const __m256i key = _mm256_set1_epi32(km.key);
+  const __m256i mask = _mm256_set1_epi32(km.mask);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256i eq = _mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (keys + i)), mask),
+      _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (masks + i)), key)
+    );
+    hits |= ((uint64_t) _mm256_movemask_ps(_mm256_castsi256_ps(eq))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_soa_sse2(keys + i, masks + i, n - i, km) << i;
+  }
+  return hits;
+}
+
+__attribute__((target("avx512f")))
+inline uint64_t intersect_soa_avx512(const uint32_t* keys,
+                                     const uint32_t* masks,
+                                     unsigned int n,
+                                     const RoutingTable::KeyMask km)
+{
+  const __m512i key = _mm512_set1_epi32(km.key);
+  const __m512i mask = _mm512_set1_epi32(km.mask);
+
+  uint64_t hits = 0;
+  unsigned int i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    hits |= ((uint64_t) _mm512_cmpeq_epi32_mask(
+      _mm512_and_si512(_mm512_loadu_si512(keys + i), mask),
+      _mm512_and_si512(_mm512_loadu_si512(masks + i), key))) << i;
+  }
+
+  // Handle any remaining entries with a narrower kernel
+  if (i < n)
+  {
+    hits |= intersect_soa_avx2(keys + i, masks + i, n - i, km) << i;
+  }
+  return hits;
+}
+#endif
+
+inline SoAKernel select_soa_kernel()
+{
+#ifdef RIG_INTERSECT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return intersect_soa_avx512;
+  }
+  else if (__builtin_cpu_supports("avx2"))
+  {
+    return intersect_soa_avx2;
+  }
+  else if (__builtin_cpu_supports("sse2"))
+  {
+    return intersect_soa_sse2;
+  }
+#endif
+  return intersect_soa_scalar;
+}
+
+inline SoAKernel get_soa_kernel()
+{
+  static const SoAKernel kernel = select_soa_kernel();
+  return kernel;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Range queries *************************************************************/
+// Get the intersection bitmap of a block of up to 64 entries of a table whose
+// entries are held contiguously, such as a Table or an ArenaTable. Other
+// layouts provide their own get_hits, found by argument-dependent lookup, see
+// soa_table.h.
+template <typename T>
+uint64_t get_hits(const T& table,
+                  unsigned int begin,
+                  unsigned int n,
+                  const RoutingTable::KeyMask km)
+{
+  return get_kernel()(table.data() + begin, n, km);
+}
+
+// Queries of a range of a table, answered by testing blocks of entries with
+// get_hits. Tables with an index of their own specialise this, see
+// indexed_table.h; the specialisation need only be declared before the first
+// query of such a table is made. Each query adds the number of entries it
+// tested for intersection to `tests`.
+template <typename T>
+struct RangeQuery
+{
+  static unsigned int find_first(const T& table,
+                                 unsigned int begin,
+                                 unsigned int end,
+                                 const RoutingTable::KeyMask km,
+                                 unsigned int& tests)
+  {
+    for (unsigned int i = begin; i < end; i += BLOCK)
+    {
+      const unsigned int n = end - i < BLOCK ? end - i : BLOCK;
+      const uint64_t hits = get_hits(table, i, n, km);
+      tests += n;
+      if (hits)
+      {
+        return i + __builtin_ctzll(hits);
+      }
+    }
+    return end;
+  }
+
+  template <typename F>
+  static void for_each(const T& table,
+                       unsigned int begin,
+                       unsigned int end,
+                       const RoutingTable::KeyMask km,
+                       F f,
+                       unsigned int& tests)
+  {
+    for (unsigned int i = begin; i < end; i += BLOCK)
+    {
+      const unsigned int n = end - i < BLOCK ? end - i : BLOCK;
+      tests += n;
+      for (uint64_t hits = get_hits(table, i, n, km); hits; hits &= hits - 1)
+      {
+        f(i + __builtin_ctzll(hits));
+      }
+    }
+  }
+};
+
+// Get the index of the first entry in [begin, end) which intersects km, or end
+// if there is none.
+template <typename T>
+unsigned int find_first(const T& table,
+                        unsigned int begin,
+                        unsigned int end,
+                        const RoutingTable::KeyMask km)
+{
+  unsigned int tests = 0;
+  return RangeQuery<T>::find_first(table, begin, end, km, tests);
+}
+
+// As above, adding the number of entries tested for intersection to `tests`.
+// A scan tests whole blocks, an index only the entries it visits.
+template <typename T>
+unsigned int find_first(const T& table,
+                        unsigned int begin,
+                        unsigned int end,
+                        const RoutingTable::KeyMask km,
+                        unsigned int& tests)
+{
+  return RangeQuery<T>::find_first(table, begin, end, km, tests);
+}
+
+// Call f with the index of every entry in [begin, end) which intersects km,
+// in increasing order.
+template <typename T, typename F>
+void for_each(const T& table,
+              unsigned int begin,
+              unsigned int end,
+              const RoutingTable::KeyMask km,
+              F f)
+{
+  unsigned int tests = 0;
+  RangeQuery<T>::for_each(table, begin, end, km, f, tests);
+}
+
+// As above, adding the number of entries tested for intersection to `tests`
+template <typename T, typename F>
+void for_each(const T& table,
+              unsigned int begin,
+              unsigned int end,
+              const RoutingTable::KeyMask km,
+              F f,
+              unsigned int& tests)
+{
+  RangeQuery<T>::for_each(table, begin, end, km, f, tests);
+}
+/*****************************************************************************/
+}
@@ -0,0 +1,274 @@
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "routing_table.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Ternary key-mask trie *****************************************************/
+// An index of key-masks which answers "which key-masks intersect K" in time
+// roughly proportional to the number of key-masks sharing a prefix with K,
+// rather than to the number of key-masks in the index. Each key-mask is held
+// with a value, typically the position of its entry in a table, and queries
+// may be restricted to a range of values.
+//
+// Each node of the trie splits its key-masks three ways on one bit, from the
+// most significant down: those with a 0, those with a 1 and those with an X in
+// that bit. A query follows the child matching its own bit and the X child,
+// or every child if it has an X. Key-masks are held in leaves of up to
+// LEAF_SIZE key-masks which are split once they become larger.
+//
+// Clearing the trie keeps its nodes, and the storage of their key-masks, for
+// reuse so that a trie which is cleared and refilled in the same way does not
+// allocate any memory.
+class KeyMaskTrie
+{
+  public:
+    enum
+    {
+      LEAF_SIZE = 16,  // Key-masks held by a leaf before it is split
+    };
+
+    KeyMaskTrie() : m_nodes(1), m_n_nodes(1), m_size(0)
+    {
+    }
+
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    // Remove every key-mask from the trie
+    void clear()
+    {
+      for (unsigned int n = 0; n < m_n_nodes; n++)
+      {
+        m_nodes[n].leaf = true;
+        m_nodes[n].items.clear();
+      }
+      m_n_nodes = 1;
+      m_size = 0;
+    }
+
+    // Add a key-mask to the trie along with a value, typically the index of
+    // the entry with the key-mask.
+    void insert(const KeyMask& km, unsigned int value)
+    {
+      unsigned int node = 0;
+      int bit = 31;
+      while (!m_nodes[node].leaf)
+      {
+        node = m_nodes[node].children[branch(km, bit--)];
+      }
+
+      m_nodes[node].items.push_back({km, value});
+      m_size++;
+
+      // Split the leaf (and any leaf this produces) if it is too large, a
+      // leaf at the last bit can hold only copies of the same key-mask.
+      split(node, bit);
+    }
+
+    // Remove a key-mask with the given value from the trie, returns false if
+    // there was no such key-mask.
+    bool erase(const KeyMask& km, unsigned int value)
+    {
+      unsigned int node = 0;
+      int bit = 31;
+      while (!m_nodes[node].leaf)
+      {
+        node = m_nodes[node].children[branch(km, bit--)];
+      }
+
+      auto& items = m_nodes[node].items;
+      for (auto& item : items)
+      {
+        if (item.value == value && item.km == km)
+        {
+          item = items.back();
+          items.pop_back();
+          m_size--;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Replace the value of every key-mask with f(value)
+    template <typename F>
+    void update_values(F f)
+    {
+      for (unsigned int n = 0; n < m_n_nodes; n++)
+      {
+        for (auto& item : m_nodes[n].items)
+        {
+          item.value = f(item.value);
+        }
+      }
+    }
+
+    // Call f(km, value) for every key-mask in the trie which intersects the
+    // given key-mask (and, optionally, whose value is in [begin, end)) in no
+    // particular order, stopping early if f returns false. Returns false if f
+    // did.
+    template <typename F>
+    bool for_each_intersecting(const KeyMask& km, F f) const
+    {
+      unsigned int tests = 0;
+      return visit(0, 31, km, 0, UINT_MAX, f, tests);
+    }
+
+    template <typename F>
+    bool for_each_intersecting(const KeyMask& km,
+                               unsigned int begin,
+                               unsigned int end,
+                               F f) const
+    {
+      unsigned int tests = 0;
+      return visit(0, 31, km, begin, end, f, tests);
+    }
+
+    // As above, adding the number of key-masks tested for intersection with
+    // the given key-mask to `tests`.
+    template <typename F>
+    bool for_each_intersecting(const KeyMask& km,
+                               unsigned int begin,
+                               unsigned int end,
+                               F f,
+                               unsigned int& tests) const
+    {
+      return visit(0, 31, km, begin, end, f, tests);
+    }
+
+    // Determine if any key-mask in the trie intersects the given key-mask
+    bool any_intersecting(const KeyMask& km) const
+    {
+      return !for_each_intersecting(km, [] (const KeyMask&, unsigned int) {
+        return false;
+      });
+    }
+
+  private:
+    struct Item
+    {
+      KeyMask km;
+      unsigned int value;
+    };
+
+    struct Node
+    {
+      Node() : leaf(true)
+      {
+      }
+
+      bool leaf;
+      unsigned int children[3];  // 0, 1 and X children of an internal node
+      std::vector<Item> items;   // Key-masks in a leaf
+    };
+
+    // Get the child (0, 1 or 2 for X) of a node splitting on `bit` which
+    // holds a key-mask.
+    static unsigned int branch(const KeyMask& km, unsigned int bit)
+    {
+      return (km.mask >> bit) & 1 ? (km.key >> bit) & 1 : 2;
+    }
+
+    void split(unsigned int node, int bit)
+    {
+      if (m_nodes[node].items.size() <= LEAF_SIZE || bit < 0)
+      {
+        return;
+      }
+
+      for (unsigned int c = 0; c < 3; c++)
+      {
+        // Adding a node may move the others
+        const unsigned int child = new_node();
+        m_nodes[node].children[c] = child;
+      }
+      m_nodes[node].leaf = false;
+
+      // The items are left in the node, cleared, so that their storage is
+      // reused if the node becomes a leaf again.
+      auto& items = m_nodes[node].items;
+      for (const auto& item : items)
+      {
+        auto child = m_nodes[node].children[branch(item.km, bit)];
+        m_nodes[child].items.push_back(item);
+      }
+      items.clear();
+
+      for (unsigned int c = 0; c < 3; c++)
+      {
+        split(m_nodes[node].children[c], bit - 1);
+      }
+    }
+
+    // Get an empty leaf, reusing a node left by clear if there is one
+    unsigned int new_node()
+    {
+      if (m_n_nodes == m_nodes.size())
+      {
+        m_nodes.emplace_back();
+      }
+      return m_n_nodes++;
+    }
+
+    template <typename F>
+    bool visit(unsigned int node,
+               int bit,
+               const KeyMask& km,
+               unsigned int begin,
+               unsigned int end,
+               F& f,
+               unsigned int& tests) const
+    {
+      const auto& n = m_nodes[node];
+      if (n.leaf)
+      {
+        for (const auto& item : n.items)
+        {
+          if (item.value < begin || item.value >= end)
+          {
+            continue;
+          }
+
+          tests++;
+          if (item.km.intersect(km) && !f(item.km, item.value))
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      // Key-masks with an X in this bit may intersect any query, otherwise
+      // they may only intersect a query with the same bit or an X.
+      if (!visit(n.children[2], bit - 1, km, begin, end, f, tests))
+      {
+        return false;
+      }
+
+      const unsigned int b = branch(km, bit);
+      if (b == 2)
+      {
+        return visit(n.children[0], bit - 1, km, begin, end, f, tests) &&
+               visit(n.children[1], bit - 1, km, begin, end, f, tests);
+      }
+      return visit(n.children[b], bit - 1, km, begin, end, f, tests);
+    }
+
+    std::vector<Node> m_nodes;  // Nodes of the trie, the root is the first
+    unsigned int m_n_nodes;     // Nodes in use, the rest are kept for reuse
+    size_t m_size;              // Number of key-masks in the trie
+};
+/*****************************************************************************/
+
+}
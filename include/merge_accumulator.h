@@ -0,0 +1,142 @@
+#include <stdint.h>
+
+#include "routing_entry.h"
+
+#pragma once
+
+namespace OrderedCovering
+{
+
+/*****************************************************************************/
+/* Merge accumulator *********************************************************/
+// The entry resulting from merging a set of entries, maintained as entries are
+// added to and removed from the set. For each of the 32 bits the accumulator
+// counts how many members have a 0, a 1 or an X in their key-mask and a 1 in
+// their source and route fields, so adding or removing a member costs the
+// same however large the set is and the merged entry may be read at any time
+// without revisiting the members.
+//
+// The merged entry is that which would be produced by merge_entries for the
+// same set of entries.
+class MergeAccumulator
+{
+  public:
+    MergeAccumulator()
+    {
+      clear();
+    }
+
+    // Accumulate every entry of a table included in a merge, which may be a
+    // BitVector or any other BasicBitVector.
+    template <typename T, typename M>
+    MergeAccumulator(const T& table, const M& merge)
+    {
+      clear();
+      for (auto i : merge.set_bits())
+      {
+        add(get_entry(table, i));
+      }
+    }
+
+    // Remove every member
+    void clear()
+    {
+      m_size = 0;
+      for (unsigned int b = 0; b < 32; b++)
+      {
+        m_zeros[b] = m_ones[b] = m_xs[b] = m_sources[b] = m_routes[b] = 0;
+      }
+    }
+
+    void add(const RoutingTable::Entry& entry)
+    {
+      update(entry, +1);
+      m_size++;
+    }
+
+    // Remove a member, the entry must previously have been added
+    void remove(const RoutingTable::Entry& entry)
+    {
+      update(entry, -1);
+      m_size--;
+    }
+
+    // Get the number of members
+    unsigned int size() const
+    {
+      return m_size;
+    }
+
+    // Get the entry resulting from merging every member
+    RoutingTable::Entry entry() const
+    {
+      if (m_size == 0)
+      {
+        return {{0x0, 0x0}, 0x0, 0x0};
+      }
+
+      // A bit of the merged key-mask is an X if any member has an X there or
+      // if the members disagree, otherwise it takes the value they share.
+      uint32_t any_zeros = 0x0, any_ones = 0x0, any_xs = 0x0;
+      uint32_t sources = 0x0, routes = 0x0;
+      for (unsigned int b = 0; b < 32; b++)
+      {
+        any_zeros |= (uint32_t) (m_zeros[b] != 0) << b;
+        any_ones  |= (uint32_t) (m_ones[b] != 0) << b;
+        any_xs    |= (uint32_t) (m_xs[b] != 0) << b;
+        sources   |= (uint32_t) (m_sources[b] != 0) << b;
+        routes    |= (uint32_t) (m_routes[b] != 0) << b;
+      }
+
+      const uint32_t mask = ~(any_xs | (any_zeros & any_ones));
+      return {{any_ones & mask, mask}, sources, routes};
+    }
+
+    RoutingTable::KeyMask keymask() const
+    {
+      return entry().keymask;
+    }
+
+    // Get the number of members with a 0 in a bit of their key-mask
+    unsigned int zeros(unsigned int bit) const
+    {
+      return m_zeros[bit];
+    }
+
+    // Get the number of members with a 1 in a bit of their key
+    unsigned int ones(unsigned int bit) const
+    {
+      return m_ones[bit];
+    }
+
+    // Get the number of members with an X in a bit of their key-mask
+    unsigned int xs(unsigned int bit) const
+    {
+      return m_xs[bit];
+    }
+
+  private:
+    void update(const RoutingTable::Entry& entry, int n)
+    {
+      const uint32_t key = entry.keymask.key, mask = entry.keymask.mask;
+      for (unsigned int b = 0; b < 32; b++)
+      {
+        m_zeros[b]   += n * (int) ((~key & mask) >> b & 1);
+        m_ones[b]    += n * (int) (key >> b & 1);
+        m_xs[b]      += n * (int) (~mask >> b & 1);
+        m_sources[b] += n * (int) (entry.source >> b & 1);
+        m_routes[b]  += n * (int) (entry.route >> b & 1);
+      }
+    }
+
+    unsigned int m_size;  // Number of members
+
+    // Number of members with a 0 or an X in each bit of their key-mask and
+    // with a 1 in each bit of their key, source and route. A key should have
+    // no 1s where its mask has 0s, if one does the bit is counted as an X
+    // and as a 1 and is an X in the merged entry, as for merge_entries.
+    int m_zeros[32], m_ones[32], m_xs[32], m_sources[32], m_routes[32];
+};
+/*****************************************************************************/
+
+}
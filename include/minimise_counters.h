@@ -0,0 +1,62 @@
+#pragma once
+
+namespace OrderedCovering
+{
+
+/*****************************************************************************/
+/* Minimisation statistics ***************************************************/
+// Statistics are collected by passing a stats policy to minimise and the
+// functions beneath it. NoStats, the default, does nothing and compiles away
+// entirely; Stats (see minimise_stats.h) counts the work done and the time
+// spent in each phase. Both provide:
+//
+//   count(counter, n)  Add n to a counter
+//   time(phase)        Get a timer which adds the time until it is stopped,
+//                      or destroyed, to a phase
+//   add(other)         Add every statistic collected by another of the same
+//                      policy
+
+// Counters of the work done while minimising
+enum Counter
+{
+  ITERATIONS,         // Merges applied
+  CANDIDATES,         // Candidate merges refined
+  DOWNCHECK_ROUNDS,   // Scans for entries covered by a merge
+  UPCHECK_ROUNDS,     // Scans for entries covering an entry of a merge
+  DOWNCHECK_REMOVED,  // Entries pruned from merges by the down-check
+  UPCHECK_REMOVED,    // Entries pruned from merges by the up-check
+  INTERSECT_TESTS,    // Table entries tested for intersection, by a scan or
+                      // in the key-mask index
+  ALIASES_SCANNED,    // Aliases tested for intersection
+  N_COUNTERS
+};
+
+// Phases of minimisation; the down-check and the up-check are part of
+// selection and, when candidates are refined concurrently, their times are
+// summed over every worker.
+enum Phase
+{
+  INDEXING,   // Indexing the table before the first merge
+  SELECTION,  // Choosing each merge
+  DOWNCHECK,  // Refining candidates by the down-check
+  UPCHECK,    // Refining candidates by the up-check
+  APPLY,      // Applying merges to the table and indices
+  N_PHASES
+};
+
+// Collect no statistics
+struct NoStats
+{
+  struct Timer
+  {
+    ~Timer() {}
+    void stop() {}
+  };
+
+  void count(Counter, unsigned long long = 1) {}
+  Timer time(Phase) { return Timer(); }
+  void add(const NoStats&) {}
+};
+/*****************************************************************************/
+
+}
@@ -0,0 +1,163 @@
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "minimise_counters.h"
+
+#pragma once
+
+namespace OrderedCovering
+{
+
+/*****************************************************************************/
+/* Minimisation statistics ***************************************************/
+// See minimise_counters.h for the counters, the phases and NoStats.
+
+// Collect every statistic, the statistics may be shared by many threads
+class Stats
+{
+  public:
+    class Timer
+    {
+      public:
+        Timer(Stats* stats, Phase phase) :
+          m_stats(stats), m_phase(phase),
+          m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        Timer(Timer&& other) :
+          m_stats(other.m_stats), m_phase(other.m_phase),
+          m_start(other.m_start)
+        {
+          other.m_stats = nullptr;
+        }
+
+        ~Timer()
+        {
+          stop();
+        }
+
+        void stop()
+        {
+          if (m_stats)
+          {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_stats->m_nanoseconds[m_phase].fetch_add(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                elapsed).count(),
+              std::memory_order_relaxed
+            );
+            m_stats = nullptr;
+          }
+        }
+
+      private:
+        Stats* m_stats;
+        Phase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    Stats()
+    {
+      for (auto& counter : m_counters)
+      {
+        counter.store(0);
+      }
+      for (auto& nanoseconds : m_nanoseconds)
+      {
+        nanoseconds.store(0);
+      }
+    }
+
+    // Copying is noexcept so that containers may move objects holding stats
+    // without copying the rest of the object.
+    Stats(const Stats& other) noexcept
+    {
+      *this = other;
+    }
+
+    Stats& operator=(const Stats& other) noexcept
+    {
+      for (unsigned int i = 0; i < N_COUNTERS; i++)
+      {
+        m_counters[i].store(other.m_counters[i].load());
+      }
+      for (unsigned int i = 0; i < N_PHASES; i++)
+      {
+        m_nanoseconds[i].store(other.m_nanoseconds[i].load());
+      }
+      return *this;
+    }
+
+    void count(Counter counter, unsigned long long n = 1)
+    {
+      m_counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    Timer time(Phase phase)
+    {
+      return Timer(this, phase);
+    }
+
+    void add(const Stats& other)
+    {
+      for (unsigned int i = 0; i < N_COUNTERS; i++)
+      {
+        m_counters[i].fetch_add(other.m_counters[i].load(),
+                                std::memory_order_relaxed);
+      }
+      for (unsigned int i = 0; i < N_PHASES; i++)
+      {
+        m_nanoseconds[i].fetch_add(other.m_nanoseconds[i].load(),
+                                   std::memory_order_relaxed);
+      }
+    }
+
+    unsigned long long get(Counter counter) const
+    {
+      return m_counters[counter].load();
+    }
+
+    // Get the time spent in a phase in seconds
+    double get(Phase phase) const
+    {
+      return m_nanoseconds[phase].load() / 1e9;
+    }
+
+    // Get the statistics as a JSON object on a single line
+    std::string to_json() const
+    {
+      static const char* counter_names[N_COUNTERS] = {
+        "iterations", "candidates", "downcheck_rounds", "upcheck_rounds",
+        "downcheck_removed", "upcheck_removed", "intersect_tests",
+        "aliases_scanned",
+      };
+      static const char* phase_names[N_PHASES] = {
+        "indexing", "selection", "downcheck", "upcheck", "apply",
+      };
+
+      std::ostringstream json;
+      json << "{";
+      for (unsigned int i = 0; i < N_COUNTERS; i++)
+      {
+        json << "\"" << counter_names[i] << "\": " << get((Counter) i) << ", ";
+      }
+      json << "\"time_s\": {";
+      for (unsigned int i = 0; i < N_PHASES; i++)
+      {
+        json << (i ? ", " : "") << "\"" << phase_names[i] << "\": "
+             << get((Phase) i);
+      }
+      json << "}}";
+      return json.str();
+    }
+
+  private:
+    std::atomic<unsigned long long> m_counters[N_COUNTERS];
+    std::atomic<unsigned long long> m_nanoseconds[N_PHASES];
+};
+/*****************************************************************************/
+
+}
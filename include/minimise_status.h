@@ -0,0 +1,20 @@
+#pragma once
+
+namespace OrderedCovering
+{
+
+/*****************************************************************************/
+/* Minimisation status *******************************************************/
+// Why minimisation stopped
+enum Status
+{
+  TARGET_MET,         // The table is no longer than the target length
+  NO_MERGES,          // No merge remains which would shorten the table
+  TIMED_OUT,          // The deadline passed
+  OUT_OF_ITERATIONS,  // The maximum number of merges were applied
+  CANCELLED,          // The cancellation token was set
+  OUT_OF_MEMORY,      // A bounded minimiser exhausted its arena
+};
+/*****************************************************************************/
+
+}
@@ -1,9 +1,22 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <map>
 #include <set>
 #include <vector>
 
+#include "alias_table.h"
+#include "bit_vector.h"
+#include "indexed_table.h"
+#include "intersect.h"
+#include "merge_accumulator.h"
+#include "minimise_stats.h"
+#include "minimise_status.h"
+#include "ordered_covering_core.h"
 #include "routing_table.h"
+#include "soa_table.h"
+#include "work_stealing_pool.h"
 
 #pragma once
 
@@ -11,24 +24,236 @@ using RoutingTable::Table;
 
 namespace OrderedCovering
 {
-/* Alias table type **********************************************************/
-typedef std::map<RoutingTable::KeyMask,
-                 std::set<RoutingTable::KeyMask>> Aliases;
+/* Merge types ***************************************************************/
+// See alias_table.h for the Aliases and AliasTable types, and
+// ordered_covering_core.h for the GeneralityIndex.
 
-typedef std::vector<bool> Merge;  // TODO Own flexible bitvector
+typedef RoutingTable::BitVector Merge;
 
+// Indices of the entries of a table grouped by their route, each list of
+// indices is in increasing order. A route index which is reused for several
+// tables may hold empty lists for routes which the current table lacks.
+typedef std::map<uint32_t, std::vector<unsigned int>> RouteIndex;
+
+// The refined merge of a route group, cached between iterations of minimise
+// until a merge is applied which could change the result of refining it.
+struct CachedMerge
+{
+  bool valid;  // False if the group must be refined again
+  int goodness;  // Goodness of the refined merge
+
+  // Key-mask resulting from merging the entire group, a merge can only affect
+  // the refinement of this group if it produces an entry intersecting this.
+  RoutingTable::KeyMask keymask;
+
+  // Positions (in the route index entry for the group) of the entries in the
+  // refined merge.
+  std::vector<unsigned int> members;
+};
+typedef std::map<uint32_t, CachedMerge> MergeCache;
+
+// A route group which get_best_merge may choose. Candidates are evaluated
+// from a heap, those whose merges could be the best first, so that evaluation
+// may stop once no remaining candidate could beat the best merge found.
+struct Candidate
+{
+  // Highest goodness the refined merge of the group could have: the goodness
+  // of its cached merge if that is valid, otherwise one less than its size.
+  int bound;
+  unsigned int front;  // Position in the table of the first entry of the group
+  RouteIndex::const_iterator group;
+  CachedMerge* cached;  // Cached merge of the group, if there is a cache
+};
+
+// Buffers used by minimise which are kept between iterations, and between
+// tables minimised with the same workspace. Once the buffers have grown to fit
+// the tables being minimised no further memory is allocated, including to
+// index tables of at least KEYMASK_INDEX_LENGTH entries.
+struct Workspace
+{
+  RouteIndex routes;  // Entries of the table grouped by route
+  MergeCache cache;   // Refined merge of each route group
+  Merge merge;        // Merge chosen in each iteration
+  Merge scratch;      // Candidate merges while they are refined
+  std::vector<Candidate> candidates;  // Heap of groups to evaluate
+  std::vector<unsigned int> new_index;  // Positions of entries after a merge
+  RoutingTable::KeyMaskTrie keymasks;   // Index of the key-masks of a table
+  std::vector<unsigned int> hits;       // Results of key-mask index queries
+};
+
+/*****************************************************************************/
+
+/* Limits on minimisation ****************************************************/
+// Minimisation may be stopped early by a deadline, a limit on the number of
+// merges applied or a cancellation token, by default there is no limit. The
+// limits are checked before each merge is chosen so that the table is always
+// left valid, but a deadline may be overrun by the time taken to choose one
+// merge.
+struct Limits
+{
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::time_point::max();
+  unsigned long long max_iterations = ~0ull;
+  const std::atomic<bool>* cancel = nullptr;  // Stop once this becomes true
+};
+
+// See minimise_status.h for the Status returned by minimise.
 /*****************************************************************************/
 
 /* minimise ******************************************************************/
-void minimise(Table& table, unsigned int target_length);
-void minimise(Table& table, unsigned int target_length, Aliases& aliases);
+// Tables are expected to be sorted in increasing generality, see sort_table.
+// Every function taking a table accepts either a Table or a SoATable.
+// Functions taking `stats` record their work in it, see minimise_stats.h.
+template <typename T>
+void minimise(T& table, unsigned int target_length);
+template <typename T>
+void minimise(T& table, unsigned int target_length, Aliases& aliases);
+template <typename T, typename S = NoStats>
+void minimise(T& table,
+              unsigned int target_length,
+              AliasTable& aliases,
+              S&& stats = S());
+
+// As above, but refining candidate merges concurrently on a pool of workers.
+// The result is identical to the serial form.
+template <typename T, typename S = NoStats>
+void minimise(T& table,
+              unsigned int target_length,
+              AliasTable& aliases,
+              Parallel::WorkStealingPool& pool,
+              S&& stats = S());
+
+// As above, but stopping early if a limit is reached. The table holds the
+// merges applied so far and minimisation may be resumed by calling minimise
+// again with the same aliases.
+template <typename T, typename S = NoStats>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Limits limits,
+                S&& stats = S());
+template <typename T, typename S = NoStats>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Parallel::WorkStealingPool& pool,
+                Limits limits,
+                S&& stats = S());
+
+// As above, but using the buffers of a workspace. Minimising many tables with
+// the same workspace, and the same aliases cleared between tables, avoids
+// allocating memory once the buffers have grown to fit the tables.
+template <typename T, typename S = NoStats>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Workspace& workspace,
+                Limits limits = Limits(),
+                S&& stats = S());
+
+// Minimise a table using get_merge(generality, routes, cache) to choose each
+// merge, get_merge may return the merge by value or by reference.
+template <typename T, typename F, typename S = NoStats>
+Status minimise_with(T& table,
+                     unsigned int target_length,
+                     AliasTable& aliases,
+                     const Limits& limits,
+                     F get_merge,
+                     S&& stats = S());
+template <typename T, typename F, typename S = NoStats>
+Status minimise_with(T& table,
+                     unsigned int target_length,
+                     AliasTable& aliases,
+                     Workspace& workspace,
+                     const Limits& limits,
+                     F get_merge,
+                     S&& stats = S());
 /*****************************************************************************/
 
 /*****************************************************************************/
 /* Core of the Ordered Covering algorithm ************************************/
 
 // Get the best merge (greedy) in a routing table
-Merge get_best_merge(const Table& table, const Aliases& aliases);
+template <typename T>
+Merge get_best_merge(const T& table, const Aliases& aliases);
+template <typename T>
+Merge get_best_merge(const T& table, const AliasTable& aliases);
+template <typename T>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes);
+template <typename T, typename S = NoStats>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     MergeCache& cache,
+                     S&& stats = S());
+
+// As above, but building the merge in a workspace and returning a reference
+// to it which is valid until the workspace is next used.
+template <typename T, typename S = NoStats>
+const Merge& get_best_merge(const T& table,
+                            const GeneralityIndex& generality,
+                            const AliasTable& aliases,
+                            const RouteIndex& routes,
+                            MergeCache& cache,
+                            Workspace& workspace,
+                            S&& stats = S());
+
+// As above, but refining the route groups concurrently on a pool of workers.
+// The same merge is returned as by the serial forms.
+template <typename T>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     Parallel::WorkStealingPool& pool);
+template <typename T, typename S = NoStats>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     MergeCache& cache,
+                     Parallel::WorkStealingPool& pool,
+                     S&& stats = S());
+
+// Mark as invalid any cached merges whose refinement could be changed by the
+// insertion of the given merged entry (and the removal of the entries it
+// replaces).
+void merge_cache_invalidate(MergeCache& cache,
+                            const RoutingTable::Entry& merge_entry);
+
+// Fill a heap (ordered by LowerBound) with a candidate for every non-empty
+// route group, bounded by its cached merge if a cache is given.
+void get_candidates(const RouteIndex& routes,
+                    MergeCache* cache,
+                    std::vector<Candidate>& candidates);
+
+// Refine the merge of an entire route group and store it in the cache,
+// `scratch` must be a merge of the same size as the table.
+template <typename T, typename S = NoStats>
+void refine_cached_merge(const T& table,
+                         const GeneralityIndex& generality,
+                         const AliasTable& aliases,
+                         const std::vector<unsigned int>& indices,
+                         CachedMerge& cached,
+                         Merge& scratch,
+                         S&& stats = S());
+
+// Construct the merge described by a cache entry (or an empty merge if the
+// entry is null).
+Merge get_cached_merge(const unsigned int table_size,
+                       const CachedMerge* cached,
+                       const std::vector<unsigned int>* group);
+void get_cached_merge(Merge& merge,
+                      const unsigned int table_size,
+                      const CachedMerge* cached,
+                      const std::vector<unsigned int>* group);
+
+// Mark every cached merge as invalid before minimising a new table
+void merge_cache_reset(MergeCache& cache);
 
 // Get the position in a table where a new entry of given generality should be
 // inserted.
@@ -45,10 +270,37 @@ Table::const_iterator get_insertion_index(
   const Merge& merge
 );
 
+// As above, but in constant time using an index of the table
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const unsigned int generality
+);
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const RoutingTable::Entry& entry
+);
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const Merge& merge
+);
+
+// As above, but giving the position as an offset from the start of the table,
+// see ordered_covering_core.h for the forms given a generality or an entry.
+template <typename T>
+unsigned int get_insertion_offset(
+  const T& table,
+  const GeneralityIndex& index,
+  const Merge& merge
+);
+
 // Refine a merge by pruning any entries which would cause an entry lower in
 // the table to become covered.
+template <typename T>
 int refine_merge_downcheck(
-  const Table& table,
+  const T& table,
   const Aliases& aliases,
   Merge& merge,
   const int min_goodness
@@ -56,8 +308,9 @@ int refine_merge_downcheck(
 
 // Refine a merge by pruning any entries which would be covered existing
 // entries higher in the table.
+template <typename T>
 int refine_merge_upcheck(
-  const Table& table,
+  const T& table,
   Merge& merge,
   const int min_goodness
 );
@@ -70,175 +323,497 @@ int refine_merge_upcheck(
 // table the original routing table entries and lead to the insertion of a new
 // entry.
 
-// Generate the entry that would be the result of a merge
-RoutingTable::Entry merge_entries(const Table& table,
-                                         const Merge& merge);
-
-// Get the number of entries contained within a merge
-int merge_goodness(const Merge& merge);
-
 // Apply a merge to a routing table
-void merge_apply(Table& table,
+template <typename T>
+void merge_apply(T& table,
                         Aliases& aliases,
                         const Merge& merge);
+template <typename T>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes);
+template <typename T>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes,
+                 std::vector<unsigned int>& new_index);
+
+// As above, but also updating the key-mask index of an indexed table
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge);
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 std::vector<unsigned int>& new_index);
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes,
+                 std::vector<unsigned int>& new_index);
+
+// Get the position every entry of a table will have once a merge has been
+// applied, `insertion_point` is where the merged entry will be inserted. The
+// merged entry will be at new_index[insertion_point] - 1.
+std::vector<unsigned int> get_new_indices(const Merge& merge,
+                                          const unsigned int insertion_point);
+
+// Tables of at least this many entries are indexed by key-mask while they are
+// minimised, see indexed_table.h.
+const unsigned int KEYMASK_INDEX_LENGTH = 4096;
+
+// Call f with the table, or with the table indexed by key-mask if it is long
+// enough for the index to be worthwhile. The index may be built in the
+// buffers of a workspace.
+template <typename T, typename F>
+auto with_keymask_index(T& table, F f);
+template <typename T, typename F>
+auto with_keymask_index(T& table, Workspace& workspace, F f);
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Generality index **********************************************************/
+// Sort a table into increasing generality (stable, in linear time)
+template <typename T>
+void sort_table(T& table);
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Route index ***************************************************************/
+// Group the entries of a table by their route
+template <typename T>
+RouteIndex get_route_index(const T& table);
+
+// As above, but reusing the lists of an existing route index. The lists of
+// routes which the table lacks are left empty rather than removed.
+template <typename T>
+void get_route_index(const T& table, RouteIndex& routes);
+
+// Update a route index to reflect the application of a merge to the table it
+// indexes, `insertion_point` is where the merged entry was inserted relative
+// to the table before the merge was applied.
+void route_index_apply(RouteIndex& routes,
+                       const Merge& merge,
+                       const uint32_t route,
+                       const unsigned int insertion_point);
+void route_index_apply(RouteIndex& routes,
+                       const Merge& merge,
+                       const uint32_t route,
+                       const unsigned int insertion_point,
+                       std::vector<unsigned int>& new_index);
 /*****************************************************************************/
 
 /*****************************************************************************/
 /* Get best merge ************************************************************/
-Merge get_best_merge(const Table& table, const Aliases& aliases)
+template <typename T>
+Merge get_best_merge(const T& table, const Aliases& aliases)
+{
+  return get_best_merge(table, AliasTable(aliases));
+}
+
+template <typename T>
+Merge get_best_merge(const T& table, const AliasTable& aliases)
+{
+  return get_best_merge(table, get_generality_index(table), aliases,
+                        get_route_index(table));
+}
+
+template <typename T>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes)
 {
-  // Create holders for the current best merge and its goodness
+  // Every group of entries sharing a route is a candidate merge.
+  auto candidates = std::vector<Candidate>();
+  get_candidates(routes, nullptr, candidates);
+
+  // Scratch merge which is cleared and reused for every candidate rather than
+  // allocating a new table-sized merge each time.
   auto best_merge = Merge(table.size(), false);
-  int best_goodness = 0;
-
-  // Create a bitset to track which routing table entries have been considered
-  // as part of a merge.
-  auto considered = std::vector<bool>(table.size(), false);
-
-  // For every entry in the table which hasn't already been considered as part
-  // of a merge look through the rest of the table to determine with which
-  // other entries it could be merged.
-  unsigned int index = 0;
-  for (auto p_entry = table.begin();
-       p_entry < table.end();
-       p_entry++, index++)
+  auto current_merge = Merge(table.size(), false);
+  select_best_merge(table, generality, aliases, candidates, best_merge,
+                    current_merge,
+                    [] (const Candidate& candidate, Merge& merge)
+                    {
+                      for (auto i : candidate.group->second)
+                      {
+                        merge.set(i);
+                      }
+                    });
+
+  return best_merge;
+}
+
+template <typename T, typename S>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     MergeCache& cache,
+                     S&& stats)
+{
+  auto workspace = Workspace();
+  return get_best_merge(table, generality, aliases, routes, cache, workspace,
+                        stats);
+}
+
+template <typename T, typename S>
+const Merge& get_best_merge(const T& table,
+                            const GeneralityIndex& generality,
+                            const AliasTable& aliases,
+                            const RouteIndex& routes,
+                            MergeCache& cache,
+                            Workspace& workspace,
+                            S&& stats)
+{
+  // Evaluate the candidates with the highest bounds first. A candidate with
+  // a valid cached merge costs nothing to evaluate; any other is refined only
+  // if its size suggests it could beat the best merge so far, and is then
+  // cached whether or not it does.
+  auto& candidates = workspace.candidates;
+  get_candidates(routes, &cache, candidates);
+
+  auto& current_merge = workspace.scratch;
+  current_merge.resize(table.size());
+  const CachedMerge* best = nullptr;
+  const std::vector<unsigned int>* best_group = nullptr;
+  unsigned int best_front = 0;
+
+  while (!candidates.empty())
   {
-    auto entry = *p_entry;
+    std::pop_heap(candidates.begin(), candidates.end(), LowerBound());
+    const auto candidate = candidates.back();
+    candidates.pop_back();
 
-    // Skip to the next entry if this entry has already been considered.
-    if (considered[index])
+    const int beat = min_goodness(best ? best->goodness : 0, best_front,
+                                  candidate.front);
+    if (candidate.bound <= beat)
     {
-      continue;
+      break;
+    }
+
+    auto& cached = *candidate.cached;
+    if (!cached.valid)
+    {
+      refine_cached_merge(table, generality, aliases, candidate.group->second,
+                          cached, current_merge, stats);
+    }
+
+    if (cached.goodness > beat)
+    {
+      best = &cached;
+      best_group = &candidate.group->second;
+      best_front = candidate.front;
+    }
+  }
+
+  get_cached_merge(workspace.merge, table.size(), best, best_group);
+  return workspace.merge;
+}
+
+template <typename T>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     Parallel::WorkStealingPool& pool)
+{
+  // Every group is refined as a separate task, the largest groups first as
+  // they are the most likely to produce a good merge early and so allow the
+  // remaining groups to be pruned.
+  auto groups = std::vector<const std::vector<unsigned int>*>();
+  for (const auto& route_entries : routes)
+  {
+    if (!route_entries.second.empty())
+    {
+      groups.push_back(&route_entries.second);
+    }
+  }
+  std::sort(groups.begin(), groups.end(),
+            [] (auto a, auto b) { return a->front() < b->front(); });
+
+  auto tasks = std::vector<unsigned int>(groups.size());
+  for (unsigned int i = 0; i < tasks.size(); i++)
+  {
+    tasks[i] = i;
+  }
+  std::stable_sort(tasks.begin(), tasks.end(),
+                   [&groups] (unsigned int a, unsigned int b) {
+                     return groups[a]->size() > groups[b]->size();
+                   });
+
+  // Best goodness found by any task so far. Groups are pruned only once they
+  // can no longer equal this so that, as in the serial form, ties can be
+  // broken in favour of the group which starts highest in the table.
+  std::atomic<int> best_goodness(0);
+  auto goodness = std::vector<int>(groups.size(), 0);
+  auto members = std::vector<std::vector<unsigned int>>(groups.size());
+
+  pool.run(tasks, [&] (unsigned int g)
+  {
+    const auto& indices = *groups[g];
+    int current_goodness = ((int) indices.size()) - 1;
+    int best = best_goodness.load();
+    if (current_goodness < 1 || current_goodness < best)
+    {
+      return;
     }
-    considered[index] = true;
 
-    // Look through the rest of the table to see which other entries this entry
-    // could be merged.
     auto current_merge = Merge(table.size(), false);
-    current_merge[index] = true;
-    int current_goodness = 0;
+    for (auto i : indices)
+    {
+      current_merge.set(i);
+    }
 
-    for (auto p_other = p_entry + 1; p_other < table.end(); p_other++)
+    // A refinement which beats the pruning threshold is identical to an
+    // unpruned refinement, anything else cannot be the best merge.
+    const int min_goodness = best > 0 ? best - 1 : 0;
+    current_goodness -= refine_merge(table, generality, aliases,
+                                     current_merge, min_goodness);
+    if (current_goodness <= min_goodness)
     {
-      unsigned int other_index = p_other - table.begin();
-      auto other = *p_other;
+      return;
+    }
 
-      // If the routes are the same then the entries may be merged.
-      if (other.route == entry.route)
-      {
-        current_merge[other_index] = true;
-        considered[other_index] = true;
-        current_goodness++;
-      }
+    goodness[g] = current_goodness;
+    for (auto i : current_merge.set_bits())
+    {
+      members[g].push_back(i);
     }
 
-    // If this merge is better than the current best then work to ensure that
-    // it is valid.
-    if (current_goodness > best_goodness)
+    while (current_goodness > best &&
+           !best_goodness.compare_exchange_weak(best, current_goodness))
     {
-      // Remove entries such that it would not cover any existing entries.
-      current_goodness -= refine_merge_downcheck(
-        table, aliases, current_merge, best_goodness);
+    }
+  });
 
-      if (current_goodness > best_goodness)
+  // Choose the best merge, preferring the group which starts highest in the
+  // table.
+  auto best_merge = Merge(table.size(), false);
+  int best = 0;
+  for (unsigned int g = 0; g < groups.size(); g++)
+  {
+    if (goodness[g] > best)
+    {
+      best = goodness[g];
+      merge_clear(best_merge);
+      for (auto i : members[g])
       {
-        // Remove entries which would be covered by any existing entries.
-        int removed = refine_merge_upcheck(table, current_merge,
-                                           best_goodness);
-        current_goodness -= removed;
-
-        // If entries were removed then the down-check needs to be recomputed.
-        if (removed && current_goodness > best_goodness)
-        {
-          current_goodness -= refine_merge_downcheck(
-            table, aliases, current_merge, best_goodness);
-        }
-
-        // Finally, if this merge is still better than the best known merge we
-        // record it as the best known merge.
-        if (current_goodness > best_goodness)
-        {
-          best_goodness = current_goodness;
-          best_merge = current_merge;
-        }
+        best_merge.set(i);
       }
     }
   }
 
   return best_merge;
 }
-/*****************************************************************************/
 
-/*****************************************************************************/
-/* Completely empty a merge **************************************************/
-// TODO Reimplement as a method of the bitvector type!
-void merge_clear(Merge& merge)
+template <typename T, typename S>
+Merge get_best_merge(const T& table,
+                     const GeneralityIndex& generality,
+                     const AliasTable& aliases,
+                     const RouteIndex& routes,
+                     MergeCache& cache,
+                     Parallel::WorkStealingPool& pool,
+                     S&& stats)
 {
-  for (unsigned int i = 0; i < merge.size(); i++)
+  // Candidates are evaluated in the same order, and the same candidates are
+  // refined, as by the serial form. Waves of candidates are taken from the top
+  // of the heap and those without valid cached merges are refined at once,
+  // without updating the cache. The wave is then replayed in order and only
+  // the refinements which the serial form would have made are kept, along
+  // with their statistics; the rest are discarded.
+  auto candidates = std::vector<Candidate>();
+  get_candidates(routes, &cache, candidates);
+
+  const CachedMerge* best = nullptr;
+  const std::vector<unsigned int>* best_group = nullptr;
+  unsigned int best_front = 0;
+
+  auto wave = std::vector<Candidate>();
+  auto tasks = std::vector<unsigned int>();
+  bool done = false;
+  while (!done && !candidates.empty())
   {
-    merge[i] = false;
+    // Take candidates which could beat the best merge so far, until there is
+    // a stale candidate for every worker.
+    const int best_goodness = best ? best->goodness : 0;
+    wave.clear();
+    tasks.clear();
+    while (!candidates.empty() && tasks.size() < pool.size() &&
+           candidates.front().bound > min_goodness(best_goodness, best_front,
+                                                   candidates.front().front))
+    {
+      std::pop_heap(candidates.begin(), candidates.end(), LowerBound());
+      if (!candidates.back().cached->valid)
+      {
+        tasks.push_back(wave.size());
+      }
+      wave.push_back(candidates.back());
+      candidates.pop_back();
+    }
+
+    if (wave.empty())
+    {
+      break;
+    }
+
+    auto refined = std::vector<CachedMerge>(wave.size());
+    auto refined_stats = std::vector<std::decay_t<S>>(wave.size());
+    pool.run(tasks, [&] (unsigned int w)
+    {
+      auto current_merge = Merge(table.size(), false);
+      refine_cached_merge(table, generality, aliases, wave[w].group->second,
+                          refined[w], current_merge, refined_stats[w]);
+    });
+
+    for (unsigned int w = 0; w < wave.size(); w++)
+    {
+      const auto& candidate = wave[w];
+      const int beat = min_goodness(best ? best->goodness : 0, best_front,
+                                    candidate.front);
+      if (candidate.bound <= beat)
+      {
+        done = true;
+        break;
+      }
+
+      auto& cached = *candidate.cached;
+      if (!cached.valid)
+      {
+        std::swap(cached, refined[w]);
+        stats.add(refined_stats[w]);
+      }
+
+      if (cached.goodness > beat)
+      {
+        best = &cached;
+        best_group = &candidate.group->second;
+        best_front = candidate.front;
+      }
+    }
   }
+
+  return get_cached_merge(table.size(), best, best_group);
 }
-/*****************************************************************************/
 
-/*****************************************************************************/
-/* Compute the goodness of a merge *******************************************/
-// TODO Reimplement as a method of the bitvector type
-int merge_goodness(const Merge& merge)
+void get_candidates(const RouteIndex& routes,
+                    MergeCache* cache,
+                    std::vector<Candidate>& candidates)
 {
-  // Just count the number of set elements in the merge
-  int count = -1;
-  for (auto b : merge)
+  candidates.clear();
+  for (auto group = routes.begin(); group != routes.end(); group++)
   {
-    if (b)
+    if (!group->second.empty())
     {
-      count++;
+      auto cached = cache ? &(*cache)[group->first] : nullptr;
+      const int bound = cached && cached->valid ?
+        cached->goodness : ((int) group->second.size()) - 1;
+      candidates.push_back({bound, group->second.front(), group, cached});
     }
   }
-  return count;
+  std::make_heap(candidates.begin(), candidates.end(), LowerBound());
 }
-/*****************************************************************************/
 
-/*****************************************************************************/
-/* Get the entry resulting from a merge **************************************/
-RoutingTable::Entry merge_entries(const Table& table,
-                                         const Merge& merge)
+template <typename T, typename S>
+void refine_cached_merge(const T& table,
+                         const GeneralityIndex& generality,
+                         const AliasTable& aliases,
+                         const std::vector<unsigned int>& indices,
+                         CachedMerge& cached,
+                         Merge& scratch,
+                         S&& stats)
 {
-  // Iterate through the table, combining the entries.
-  uint32_t any_ones = 0x00000000;  // Where there is a one in ANY of the keys
-  uint32_t all_ones = 0xffffffff;  // Where there is a one in ALL of the keys
-  uint32_t all_sels = 0xffffffff;  // Where there is a one in ALL of the masks
-  uint32_t sources  = 0x00000000;  // Union of the source fields
+  // The merge is refined without pruning against the current best goodness
+  // so that the result can be reused in later iterations; a pruned refinement
+  // which beats the best goodness is identical to an unpruned one.
+  merge_clear(scratch);
+  for (auto i : indices)
+  {
+    scratch.set(i);
+  }
+  cached.keymask = merge_entries(table, scratch).keymask;
+  cached.goodness = ((int) indices.size()) - 1;
 
-  // Union of the route fields (we rely on the caller to ensure what they are
-  // doing is valid!)
-  uint32_t routes   = 0x00000000;
+  if (cached.goodness > 0)
+  {
+    stats.count(CANDIDATES);
+    cached.goodness -= refine_merge(table, generality, aliases, scratch, 0,
+                                    stats);
+  }
 
-  for (unsigned int i = 0; i < table.size(); i++)
+  cached.members.clear();
+  for (unsigned int j = 0; j < indices.size(); j++)
   {
-    // If this entry is in the merge then include the entry
-    if (merge[i])
+    if (scratch[indices[j]])
     {
-      // Get the entry
-      auto entry = table[i];
-
-      // Include in the values
-      any_ones |= entry.keymask.key;
-      all_ones &= entry.keymask.key;
-      all_sels &= entry.keymask.mask;
-      sources  |= entry.source;
-      routes   |= entry.route;
+      cached.members.push_back(j);
     }
   }
+  cached.valid = true;
+}
 
-  // Compute the new key and mask
-  auto any_zeros = ~all_ones;
-  auto new_xs = any_ones ^ any_zeros;
-  auto mask = all_sels & new_xs;  // Combine existing and new Xs
-  auto key = all_ones & mask;
+Merge get_cached_merge(const unsigned int table_size,
+                       const CachedMerge* cached,
+                       const std::vector<unsigned int>* group)
+{
+  auto merge = Merge();
+  get_cached_merge(merge, table_size, cached, group);
+  return merge;
+}
+
+void get_cached_merge(Merge& merge,
+                      const unsigned int table_size,
+                      const CachedMerge* cached,
+                      const std::vector<unsigned int>* group)
+{
+  merge.resize(table_size);
+  merge_clear(merge);
+  if (cached)
+  {
+    for (auto j : cached->members)
+    {
+      merge.set((*group)[j]);
+    }
+  }
+}
 
-  // Create and return the new entry
-  return {{key, mask}, sources, routes};
+void merge_cache_reset(MergeCache& cache)
+{
+  // The lists of members are kept so that their memory may be reused
+  for (auto& route_cache : cache)
+  {
+    route_cache.second.valid = false;
+  }
+}
+
+void merge_cache_invalidate(MergeCache& cache,
+                            const RoutingTable::Entry& merge_entry)
+{
+  // The refinement of a group depends only on its own entries and on those
+  // entries (and their aliases) which intersect the merged key-mask of the
+  // group. Applying a merge changes the group of the route of the merge and
+  // inserts an entry which covers every entry it replaces, so only groups
+  // which intersect the new entry need be refined again.
+  for (auto& route_cache : cache)
+  {
+    auto& cached = route_cache.second;
+    if (route_cache.first == merge_entry.route ||
+        cached.keymask.intersect(merge_entry.keymask))
+    {
+      cached.valid = false;
+    }
+  }
 }
 /*****************************************************************************/
 
@@ -298,294 +873,301 @@ Table::const_iterator get_insertion_index(
   auto new_entry = merge_entries(table, merge);
   return get_insertion_index(table, new_entry);
 }
+
+// For a given generality, using an index
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const unsigned int generality
+)
+{
+  return table.cbegin() + get_insertion_offset(index, generality);
+}
+
+// For a given entry, using an index
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const RoutingTable::Entry& entry
+)
+{
+  return table.cbegin() + get_insertion_offset(index, entry);
+}
+
+// For a given merge, using an index
+Table::const_iterator get_insertion_index(
+  const Table& table,
+  const GeneralityIndex& index,
+  const Merge& merge
+)
+{
+  return table.cbegin() + get_insertion_offset(table, index, merge);
+}
+
+// For a given merge, as an offset
+template <typename T>
+unsigned int get_insertion_offset(
+  const T& table,
+  const GeneralityIndex& index,
+  const Merge& merge
+)
+{
+  auto new_entry = merge_entries(table, merge);
+  return get_insertion_offset(index, new_entry);
+}
 /*****************************************************************************/
 
 /*****************************************************************************/
 /* Apply a merge *************************************************************/
-void merge_apply(Table& table,
+template <typename T>
+void merge_apply(T& table,
                         Aliases& aliases,
                         const Merge& merge)
 {
-  // Get the merged entry and where to insert it in the table.
+  auto generality = get_generality_index(table);
+  auto table_aliases = AliasTable(aliases);
+  merge_apply(table, generality, table_aliases, merge);
+  aliases = table_aliases.to_aliases();
+}
+
+template <typename T>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes)
+{
+  // Determine where the merged entry will be inserted before the table is
+  // modified.
   auto merge_entry = merge_entries(table, merge);
-  auto insertion_point = get_insertion_index(table, merge_entry);
+  unsigned int insertion_point = get_insertion_offset(generality,
+                                                      merge_entry);
 
-  // Keep track of the size of the finished table.
-  unsigned int final_size = table.size() + 1;
+  // Apply the merge and then update the route index to match.
+  merge_apply(table, generality, aliases, merge);
+  route_index_apply(routes, merge, merge_entry.route, insertion_point);
+}
 
-  // Use two iterators to move through the table, copying elements from one
-  // iterator position to the other as required.
-  auto insert = table.begin();
-  for (auto remove = table.cbegin(); remove < table.cend(); remove++)
-  {
-    // Insert the new entry if this is the correct point at which to do so.
-    if (remove == insertion_point)
-    {
-      *insert = merge_entry;
-      insert++;
-    }
+template <typename T>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes,
+                 std::vector<unsigned int>& new_index)
+{
+  auto merge_entry = merge_entries(table, merge);
+  unsigned int insertion_point = get_insertion_offset(generality,
+                                                      merge_entry);
 
-    unsigned int i = remove - table.begin();
-    if (!merge[i])
-    {
-      // If this entry is not part of the merge then copy it across to the new
-      // table.
-      *insert = *remove;
-      insert++;
-    }
-    else
-    {
-      // Update the aliases table; if the entry we're removing is in the
-      // aliases list then copy all entries from its entry to the new entry, if
-      // it isn't then add just the keymask from the old entry to the aliases
-      // dictionary.
-      auto old_km = (*remove).keymask;
-      if (aliases.count(old_km))
-      {
-        // Copy all keymasks from the old entry
-        auto old_entries = (*aliases.find(old_km)).second;
-        aliases[merge_entry.keymask].insert(old_entries.begin(),
-                                            old_entries.end());
+  merge_apply(table, generality, aliases, merge);
+  route_index_apply(routes, merge, merge_entry.route, insertion_point,
+                    new_index);
+}
 
-        // Remove the old entry
-        aliases.erase(old_km);
-      }
-      else
-      {
-        // Just add the old key mask to the new entry
-        aliases[merge_entry.keymask].insert(old_km);
-      }
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge)
+{
+  auto new_index = std::vector<unsigned int>();
+  merge_apply(table, generality, aliases, merge, new_index);
+}
 
-      // Count this entry as removed.
-      final_size--;
-    }
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 std::vector<unsigned int>& new_index)
+{
+  auto merge_entry = merge_entries(table, merge);
+  const unsigned int insertion_point = get_insertion_offset(generality,
+                                                            merge_entry);
+
+  // Remove the merged entries from the index, move every other entry to its
+  // new position and add the merged entry.
+  auto& keymasks = table.keymasks();
+  for (auto i : merge.set_bits())
+  {
+    keymasks.erase(get_keymask(table, i), i);
   }
+  get_new_indices(merge, insertion_point, new_index);
+  keymasks.update_values([&new_index] (unsigned int i) {
+    return new_index[i];
+  });
+  keymasks.insert(merge_entry.keymask, new_index[insertion_point] - 1);
+
+  merge_apply(table.table(), generality, aliases, merge);
+}
 
-  // If inserting beyond the old end of the table then perform the insertion at
-  // the new end of the table.
-  if (table.end() == insertion_point)
+template <typename T>
+void merge_apply(RoutingTable::IndexedTable<T>& table,
+                 GeneralityIndex& generality,
+                 AliasTable& aliases,
+                 const Merge& merge,
+                 RouteIndex& routes,
+                 std::vector<unsigned int>& new_index)
+{
+  auto merge_entry = merge_entries(table, merge);
+  unsigned int insertion_point = get_insertion_offset(generality,
+                                                      merge_entry);
+
+  merge_apply(table, generality, aliases, merge, new_index);
+  route_index_apply(routes, merge, merge_entry.route, insertion_point,
+                    new_index);
+}
+
+std::vector<unsigned int> get_new_indices(const Merge& merge,
+                                          const unsigned int insertion_point)
+{
+  auto new_index = std::vector<unsigned int>();
+  get_new_indices(merge, insertion_point, new_index);
+  return new_index;
+}
+
+template <typename T, typename F>
+auto with_keymask_index(T& table, F f)
+{
+  if (table.size() >= KEYMASK_INDEX_LENGTH)
   {
-    *insert = merge_entry;
+    auto indexed = RoutingTable::IndexedTable<T>(table);
+    return f(indexed);
   }
+  return f(table);
+}
 
-  // Resize the table (this will only ever be a shrink of the table).
-  table.resize(final_size);
+template <typename T, typename F>
+auto with_keymask_index(T& table, Workspace& workspace, F f)
+{
+  if (table.size() >= KEYMASK_INDEX_LENGTH)
+  {
+    auto indexed = RoutingTable::IndexedTable<T>(table, workspace.keymasks,
+                                                 workspace.hits);
+    return f(indexed);
+  }
+  return f(table);
 }
 /*****************************************************************************/
 
 /*****************************************************************************/
-/* Avoid covering entries with a merge ***************************************/
-
-struct CoverInfo
+/* Generality index **********************************************************/
+template <typename T>
+void sort_table(T& table)
 {
-  // If any key-masks lower in the table than the entry resulting from the
-  // merge were covered
-  bool covers;
-  uint32_t set_to_zero;  // Bits which could be set to 0 to avoid the cover
-  uint32_t set_to_one;   // Bits which could be set to 1 to avoid the cover
+  // Counting sort on the number of Xs in each key-mask
+  auto index = get_generality_index(table);
 
-  // NOTE: If both the uint32_t s are zero and the bool is true then it is not
-  // possible to avoid the cover.
-};
+  auto sorted = T(table.size());
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    auto entry = get_entry(table, i);
+    set_entry(sorted, index.offsets[entry.keymask.count_xs()]++, entry);
+  }
+  table.swap(sorted);
+}
+/*****************************************************************************/
 
-void get_settables(RoutingTable::KeyMask& a,
-                          RoutingTable::KeyMask& b,
-                          unsigned int& stringency,
-                          uint32_t& set_to_zero,
-                          uint32_t& set_to_one)
+/*****************************************************************************/
+/* Route index ***************************************************************/
+template <typename T>
+RouteIndex get_route_index(const T& table)
 {
-  // We can avoid merging by setting to either 0 or 1 bits where the
-  // merged entry has an X but the covered entry does not.
-  uint32_t settable = a.get_xs() & ~b.get_xs();
-
-  // Compute the stringency of this collision; if it's less than the
-  // previous stringency then reset the set_to_x variables; if it's more
-  // then disregard and if it's equal then update them.
-  unsigned int this_stringency = __builtin_popcount(settable);
+  auto routes = RouteIndex();
+  get_route_index(table, routes);
+  return routes;
+}
 
-  if (this_stringency < stringency)
+template <typename T>
+void get_route_index(const T& table, RouteIndex& routes)
+{
+  for (auto& route_entries : routes)
   {
-    stringency  = this_stringency;
-    set_to_one  = settable & ~b.key;
-    set_to_zero = settable & b.key;
+    route_entries.second.clear();
   }
-  else if (this_stringency == stringency)
+
+  for (unsigned int i = 0; i < table.size(); i++)
   {
-    set_to_one  |= settable & ~b.key;
-    set_to_zero |= settable & b.key;
+    routes[get_route(table, i)].push_back(i);
   }
 }
 
-struct CoverInfo get_cover_info(
-    const Table& table,
-    const Aliases& aliases,
-    const Merge& merge
-)
+void route_index_apply(RouteIndex& routes,
+                       const Merge& merge,
+                       const uint32_t route,
+                       const unsigned int insertion_point)
 {
-  struct CoverInfo info = {false, 0x0, 0x0};
-
-  // Get the entry which would be generated by the merge
-  auto merge_entry = merge_entries(table, merge);
-  auto merge_km = merge_entry.keymask;
+  auto new_index = std::vector<unsigned int>();
+  route_index_apply(routes, merge, route, insertion_point, new_index);
+}
 
-  unsigned int stringency = 33;  // Number of bits which MAY be set
+void route_index_apply(RouteIndex& routes,
+                       const Merge& merge,
+                       const uint32_t route,
+                       const unsigned int insertion_point,
+                       std::vector<unsigned int>& new_index)
+{
+  get_new_indices(merge, insertion_point, new_index);
 
-  // Look through the table to see if there are entries below the point where
-  // the merge would be inserted which would be covered by the entry resulting
-  // from performing the merge.
-  for (auto i = get_insertion_index(table, merge_entry);
-       i != table.end(); i++)
+  for (auto& route_entries : routes)
   {
-    // Get the entry key-mask
-    auto entry_km = (*i).keymask;
+    auto& indices = route_entries.second;
 
-    if (merge_km.intersect(entry_km))
+    // Remove the merged entries from the group
+    if (route_entries.first == route)
     {
-      // See if the key-mask is in the aliases table
-      auto alias_list = aliases.find(entry_km);
-      if (alias_list == aliases.end())
-      {
-        // As there are no aliases we need to avoid colliding with the key-mask
-        // from the entry.
-        info.covers = true;
-        get_settables(merge_km, entry_km, stringency,
-                      info.set_to_zero, info.set_to_one);
-      }
-      else
-      {
-        // As this key-mask is in the aliases table then check that none of the
-        // aliased key-masks intersect with the key-mask resulting from the
-        // merge.
-        for (auto alias : (*alias_list).second)
-        {
-          if (alias.intersect(merge_km))
-          {
-            info.covers = true;
-            get_settables(merge_km, alias, stringency,
-                          info.set_to_zero, info.set_to_one);
-          }
-        }
-      }
+      indices.erase(std::remove_if(indices.begin(), indices.end(),
+                                   [&merge] (auto i) { return merge[i]; }),
+                    indices.end());
+    }
+
+    // Update the indices of the remaining entries
+    for (auto& i : indices)
+    {
+      i = new_index[i];
     }
   }
 
-  return info;
+  // Add the merged entry to its group, the new entry precedes every entry
+  // which was at or below the insertion point.
+  auto& indices = routes[route];
+  const unsigned int index = new_index[insertion_point] - 1;
+  indices.insert(std::lower_bound(indices.begin(), indices.end(), index),
+                 index);
 }
+/*****************************************************************************/
 
-template <typename F>
-std::vector<unsigned int> find_removes(
-    const Table& table,
+/*****************************************************************************/
+/* Avoid covering entries with a merge ***************************************/
+// Get the cover information for a merge, see the form given the merged entry
+// in ordered_covering_core.h.
+template <typename T, typename A, typename S = NoStats>
+struct CoverInfo get_cover_info(
+    const T& table,
+    const GeneralityIndex& generality,
+    const A& aliases,
     const Merge& merge,
-    F f
+    S&& stats = S()
 )
 {
-  // If this is a bit we could set to VAL then find all entries which
-  // contain an X or NOT VAL in the specified bit.
-  auto to_remove = std::vector<unsigned int>();
-  for (unsigned int j = 0; j < table.size(); j++)
-  {
-    if (merge[j] && f(table[j].keymask))
-    {
-      to_remove.push_back(j);
-    }
-  }
-
-  return to_remove;
+  return get_cover_info(table, generality, aliases,
+                        merge_entries(table, merge), stats);
 }
 
 // Prune a merge to ensure that no entries below the merge insertion point will
 // be covered by the new entry created by the merge.
 // Return the number of pruned entries.
+template <typename T>
 int refine_merge_downcheck(
-    const Table& table,
+    const T& table,
     const Aliases& aliases,
     Merge& merge,
     const int min_goodness
 )
 {
-  int removed = 0;                       // Count number of removed entries
-  int goodness = merge_goodness(merge);  // Original merge goodness
-
-  while (goodness > min_goodness)
-  {
-    // Determine if any covering occurs
-    auto info = get_cover_info(table, aliases, merge);
-    if (!info.covers)
-    {
-      // If there was no covering then we can break out of this loop
-      break;
-    }
-
-    if (!info.set_to_one && !info.set_to_zero)
-    {
-      // We cannot do anything to avoid covering the lower entries, so abandon
-      // the merge entirely.
-      merge_clear(merge);
-      removed += goodness + 1;
-      goodness = 0;
-    }
-    else
-    {
-      // Find the smallest number of entries we could remove to set one of the
-      // bits in the merged entry such that it would avoid covering a lower
-      // entry.
-      auto best_removes = std::vector<unsigned int>();
-      for (uint32_t bit = (1 << 31);
-           bit > 0 && best_removes.size() != 1;
-           bit >>= 1)
-      {
-        // If this bit may be set to zero then look for any entries to remove
-        // to achieve this.
-        if (bit & info.set_to_zero)
-        {
-          auto new_removes = find_removes(
-            table, merge,
-            [bit] (auto km) { return (~km.mask & bit) || (km.key & bit); }
-          );
-
-          if (((best_removes.size() == 0) ||
-               (new_removes.size() < best_removes.size())) &&
-              (new_removes.size() != 0))
-          {
-            best_removes = new_removes;
-          }
-        }
-
-        // If this bit may be set to one then look for any entries to remove to
-        // achieve this.
-        if (bit & info.set_to_one)
-        {
-          auto new_removes = find_removes(
-            table, merge,
-            [bit] (auto km) { return ~km.key & bit; }
-          );
-
-          if (((best_removes.size() == 0) ||
-               (new_removes.size() < best_removes.size())) &&
-              (new_removes.size() != 0))
-          {
-            best_removes = new_removes;
-          }
-        }
-      }
-
-      // Remove all the entries found in best_removes
-      for (auto i : best_removes)
-      {
-        merge[i] = false;
-      }
-      removed += best_removes.size();
-      goodness -= best_removes.size();
-
-      if (goodness == 0)
-      {
-        merge_clear(merge);
-        removed++;
-      }
-    }
-  }
-
-  return removed;
+  return refine_merge_downcheck(table, get_generality_index(table),
+                                AliasTable(aliases), merge, min_goodness);
 }
 /*****************************************************************************/
 
@@ -594,104 +1176,190 @@ int refine_merge_downcheck(
 // Prune a merge to ensure that no entries contained within the merge will be
 // covered by existing entries located above the insertion point of the merge.
 // Return the number of pruned entries.
+template <typename T>
 int refine_merge_upcheck(
-    const Table& table,
+    const T& table,
     Merge& merge,
     const int min_goodness
 )
 {
-  int
-    removed = 0,                       // Count number of removed entries
-    goodness = merge_goodness(merge);  // Original merge goodness
-
-  // Get the insertion position of the merge in the table.
-  auto insertion_point = get_insertion_index(table, merge);
-
-  // For each entry in the merge (in decreasing order of generality) check to
-  // see if there are any entries above the merge position which would cause
-  // the entry to become covered if the merge were to go ahead.
-  // Abort this process once the goodness of the merge is no greater than the
-  // specified minimum goodness.
-  for (auto entry = table.cend() - 1;
-       entry >= table.cbegin() && goodness > min_goodness;
-       entry--)
-  {
-    unsigned int index = entry - table.begin();  // Get the index of the entry
-
-    // Ignore this entry if it's not in the merge
-    if (merge[index])
-    {
-      // Get the key-mask of this entry
-      auto entry_km = (*entry).keymask;
-
-      // Check to see if any entry between the current entry position and the
-      // position where the merge will be inserted would partially or wholly
-      // cover the entry. If it would then remove the entry from the merge.
-      for (auto other_entry = entry + 1; other_entry < insertion_point;
-           other_entry++)
-      {
-        auto other_km = (*other_entry).keymask;
-
-        if (entry_km.intersect(other_km))
-        {
-          // This entry would become covered if the merge were to go ahead so
-          // remove it from the merge.
-          removed++;
-          goodness--;
-          merge[index] = false;
-
-          // Recompute where the entry resulting from the merge would be
-          // inserted in the table.
-          insertion_point = get_insertion_index(table, merge);
-          break;
-        }
-      }
-    }
-  }
-
-  // If the merge is now no better than the specified minimum goodness empty
-  // the merge and return.
-  if (goodness <= min_goodness)
-  {
-    // Empty the merge entirely
-    merge_clear(merge);
-    removed += goodness;
-    goodness = 0;
-  }
-
-  return removed;
+  return refine_merge_upcheck(table, get_generality_index(table), merge,
+                              min_goodness);
 }
 /*****************************************************************************/
 
 /*****************************************************************************/
 /* minimise Implementation ***************************************************/
-void minimise(Table& table, unsigned int target_length)
+template <typename T>
+void minimise(T& table, unsigned int target_length)
 {
   // Create empty aliases table and call minimise with that
-  auto aliases = Aliases();
+  auto aliases = AliasTable();
   minimise(table, target_length, aliases);
 }
 
-void minimise(Table& table,
+template <typename T>
+void minimise(T& table,
                      unsigned int target_length,
                      Aliases& aliases)
 {
+  // Convert the aliases into a hash table for the duration of the
+  // minimisation and then return them to the caller.
+  auto table_aliases = AliasTable(aliases);
+  minimise(table, target_length, table_aliases);
+  aliases = table_aliases.to_aliases();
+}
+
+template <typename T, typename S>
+void minimise(T& table,
+              unsigned int target_length,
+              AliasTable& aliases,
+              S&& stats)
+{
+  minimise(table, target_length, aliases, Limits(), stats);
+}
+
+template <typename T, typename S>
+void minimise(T& table,
+              unsigned int target_length,
+              AliasTable& aliases,
+              Parallel::WorkStealingPool& pool,
+              S&& stats)
+{
+  minimise(table, target_length, aliases, pool, Limits(), stats);
+}
+
+template <typename T, typename S>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Limits limits,
+                S&& stats)
+{
+  auto workspace = Workspace();
+  return minimise(table, target_length, aliases, workspace, limits, stats);
+}
+
+template <typename T, typename S>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Parallel::WorkStealingPool& pool,
+                Limits limits,
+                S&& stats)
+{
+  return with_keymask_index(table, [&] (auto& t)
+  {
+    return minimise_with(t, target_length, aliases, limits,
+      [&t, &aliases, &pool, &stats] (const GeneralityIndex& generality,
+                                     const RouteIndex& routes,
+                                     MergeCache& cache)
+      {
+        return get_best_merge(t, generality, aliases, routes, cache, pool,
+                              stats);
+      },
+      stats
+    );
+  });
+}
+
+template <typename T, typename S>
+Status minimise(T& table,
+                unsigned int target_length,
+                AliasTable& aliases,
+                Workspace& workspace,
+                Limits limits,
+                S&& stats)
+{
+  return with_keymask_index(table, workspace, [&] (auto& t)
+  {
+    return minimise_with(t, target_length, aliases, workspace, limits,
+      [&t, &aliases, &workspace, &stats] (const GeneralityIndex& generality,
+                                          const RouteIndex& routes,
+                                          MergeCache& cache) -> const Merge&
+      {
+        return get_best_merge(t, generality, aliases, routes, cache,
+                              workspace, stats);
+      },
+      stats
+    );
+  });
+}
+
+template <typename T, typename F, typename S>
+Status minimise_with(T& table,
+                     unsigned int target_length,
+                     AliasTable& aliases,
+                     const Limits& limits,
+                     F get_merge,
+                     S&& stats)
+{
+  auto workspace = Workspace();
+  return minimise_with(table, target_length, aliases, workspace, limits,
+                       get_merge, stats);
+}
+
+// Repeatedly apply the merge chosen by get_merge(generality, routes, cache)
+template <typename T, typename F, typename S>
+Status minimise_with(T& table,
+                     unsigned int target_length,
+                     AliasTable& aliases,
+                     Workspace& workspace,
+                     const Limits& limits,
+                     F get_merge,
+                     S&& stats)
+{
+  // Index the start of each generality and group the entries by route once,
+  // the indices are kept up to date as merges are applied. The refined merge
+  // of each group is cached until a merge is applied which could change it.
+  auto indexing = stats.time(INDEXING);
+  auto generality = get_generality_index(table);
+  auto& routes = workspace.routes;
+  auto& cache = workspace.cache;
+  get_route_index(table, routes);
+  merge_cache_reset(cache);
+  indexing.stop();
+
   // While the table is still longer than the target length continue to get
-  // and apply merges.
-  while (table.size() > target_length)
+  // and apply merges, unless a limit has been reached.
+  for (unsigned long long iterations = 0; table.size() > target_length;
+       iterations++)
   {
+    if (limits.cancel && limits.cancel->load())
+    {
+      return CANCELLED;
+    }
+    if (iterations >= limits.max_iterations)
+    {
+      return OUT_OF_ITERATIONS;
+    }
+    if (limits.deadline != std::chrono::steady_clock::time_point::max() &&
+        std::chrono::steady_clock::now() >= limits.deadline)
+    {
+      return TIMED_OUT;
+    }
+
     // Get the best candidate merge; if the merge is empty then the table
-    // cannot be further minimised and we should exit the loop.
-    Merge merge = OrderedCovering::get_best_merge(table, aliases);
+    // cannot be further minimised.
+    auto selection = stats.time(SELECTION);
+    const Merge& merge = get_merge(generality, routes, cache);
+    selection.stop();
     if (OrderedCovering::merge_goodness(merge) < 1)
     {
-      break;
+      return NO_MERGES;
     }
 
     // Otherwise apply the merge to the routing table. This will modify the
-    // table and the aliases dictionary.
-    OrderedCovering::merge_apply(table, aliases, merge);
+    // table, the aliases dictionary and the indices.
+    auto apply = stats.time(APPLY);
+    stats.count(ITERATIONS);
+    auto merge_entry = OrderedCovering::merge_entries(table, merge);
+    OrderedCovering::merge_apply(table, generality, aliases, merge, routes,
+                                 workspace.new_index);
+    OrderedCovering::merge_cache_invalidate(cache, merge_entry);
   }
+
+  return TARGET_MET;
 }
 /*****************************************************************************/
 }
@@ -0,0 +1,772 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+
+#include "intersect.h"
+#include "merge_accumulator.h"
+#include "minimise_counters.h"
+#include "minimise_status.h"
+#include "routing_entry.h"
+
+#pragma once
+
+namespace OrderedCovering
+{
+/*****************************************************************************/
+/* Core of the Ordered Covering algorithm ************************************/
+// The routines which choose and apply merges, shared by OrderedCovering
+// (ordered_covering.h) and BoundedCovering (bounded_covering.h). They are
+// generic in the table, the merge and the alias table and need neither
+// threads nor any container which allocates, so that they may be used where
+// there is no heap.
+
+// Offsets of the first entry of each generality (number of Xs in the
+// key-mask) in a table sorted in increasing generality; offsets[33] is the
+// length of the table.
+struct GeneralityIndex
+{
+  unsigned int offsets[34];
+};
+
+// Heap order of candidates: the highest bound first, then the candidate which
+// starts highest in the table, as ties are broken in its favour. Any type with
+// the bound and front of a Candidate may be ordered.
+struct LowerBound
+{
+  template <typename C>
+  bool operator()(const C& a, const C& b) const
+  {
+    return a.bound < b.bound || (a.bound == b.bound && a.front > b.front);
+  }
+};
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Choosing merges ***********************************************************/
+// Evaluate a heap of candidates (ordered by LowerBound) until none could beat
+// the best merge found, refining each in `scratch` once `set_members(candidate,
+// scratch)` has set the entries of its group. The best merge is left in
+// `best`, both merges must be of the same size as the table, and its goodness
+// is returned.
+template <typename T, typename A, typename C, typename M, typename F>
+int select_best_merge(const T& table,
+                      const GeneralityIndex& generality,
+                      const A& aliases,
+                      C& candidates,
+                      M& best,
+                      M& scratch,
+                      F set_members);
+
+// Get the goodness a candidate starting at `front` must exceed to be better
+// than the best merge so far; it need only equal the best goodness if it
+// starts higher in the table than the best merge.
+inline int min_goodness(int best_goodness, unsigned int best_front,
+                        unsigned int front);
+
+// Refine a merge by pruning any entries which would cause an entry lower in
+// the table to become covered, returning the number of entries pruned.
+template <typename T, typename A, typename M, typename S = NoStats>
+int refine_merge_downcheck(
+  const T& table,
+  const GeneralityIndex& generality,
+  const A& aliases,
+  M& merge,
+  const int min_goodness,
+  S&& stats = S()
+);
+
+// Refine a merge by pruning any entries which would be covered by existing
+// entries higher in the table, returning the number of entries pruned.
+template <typename T, typename M, typename S = NoStats>
+int refine_merge_upcheck(
+  const T& table,
+  const GeneralityIndex& generality,
+  M& merge,
+  const int min_goodness,
+  S&& stats = S()
+);
+
+// Refine a merge by applying the down-check, the up-check and, if the up-check
+// removed any entries, the down-check again.
+//
+// These, and merge_apply given a generality index, take any BasicBitVector
+// as the merge and any alias table with the lookup and replace methods of an
+// AliasTable, see BoundedCovering::minimise.
+template <typename T, typename A, typename M, typename S = NoStats>
+int refine_merge(
+  const T& table,
+  const GeneralityIndex& generality,
+  const A& aliases,
+  M& merge,
+  const int min_goodness,
+  S&& stats = S()
+);
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Merges ********************************************************************/
+// Generate the entry that would be the result of a merge
+template <typename T, typename M>
+RoutingTable::Entry merge_entries(const T& table,
+                                         const M& merge);
+
+// Get the number of entries contained within a merge
+template <typename M>
+int merge_goodness(const M& merge);
+
+// Remove all entries from a merge
+template <typename M>
+void merge_clear(M& merge);
+
+// Apply a merge to a table, its generality index and its aliases
+template <typename T, typename A, typename M>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 A& aliases,
+                 const M& merge);
+
+// Get the position every entry of a table will have once a merge has been
+// applied, `insertion_point` is where the merged entry will be inserted. The
+// merged entry will be at new_index[insertion_point] - 1.
+template <typename M, typename V>
+void get_new_indices(const M& merge,
+                     const unsigned int insertion_point,
+                     V& new_index);
+
+// Get the offset in a table where a new entry of given generality, or a given
+// new entry, should be inserted.
+inline unsigned int get_insertion_offset(
+  const GeneralityIndex& index,
+  const unsigned int generality
+);
+inline unsigned int get_insertion_offset(
+  const GeneralityIndex& index,
+  const RoutingTable::Entry& entry
+);
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Generality index **********************************************************/
+// Index the start of each generality in a table sorted by generality
+template <typename T>
+GeneralityIndex get_generality_index(const T& table);
+
+// Update a generality index to reflect the application of a merge, this must
+// be called before the merge is applied to the table.
+template <typename T, typename M>
+void generality_index_apply(GeneralityIndex& index,
+                            const T& table,
+                            const M& merge,
+                            const RoutingTable::Entry& merge_entry);
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Choose the best merge *****************************************************/
+template <typename T, typename A, typename C, typename M, typename F>
+int select_best_merge(const T& table,
+                      const GeneralityIndex& generality,
+                      const A& aliases,
+                      C& candidates,
+                      M& best,
+                      M& scratch,
+                      F set_members)
+{
+  // Create holders for the current best merge and its goodness
+  merge_clear(best);
+  int best_goodness = 0;
+  unsigned int best_front = 0;
+
+  // Candidates are refined largest first, until no remaining candidate could
+  // beat the best merge, so groups which could not be chosen are never
+  // refined. Ties are broken in favour of the merge which starts highest in
+  // the table.
+  while (!candidates.empty())
+  {
+    std::pop_heap(candidates.begin(), candidates.end(), LowerBound());
+    const auto candidate = candidates.back();
+    candidates.pop_back();
+
+    const int beat = min_goodness(best_goodness, best_front, candidate.front);
+    if (candidate.bound <= beat)
+    {
+      break;
+    }
+
+    merge_clear(scratch);
+    set_members(candidate, scratch);
+
+    // Remove entries such that the merge would not cover, or be covered by,
+    // any existing entries. If this merge is still better than the best
+    // known merge we record it as the best known merge.
+    const int goodness = candidate.bound -
+      refine_merge(table, generality, aliases, scratch, beat);
+    if (goodness > beat)
+    {
+      best_goodness = goodness;
+      best_front = candidate.front;
+      best = scratch;
+    }
+  }
+
+  return best_goodness;
+}
+
+inline int min_goodness(int best_goodness, unsigned int best_front,
+                        unsigned int front)
+{
+  return best_goodness > 0 && front < best_front ? best_goodness - 1
+                                                 : best_goodness;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Completely empty a merge **************************************************/
+template <typename M>
+void merge_clear(M& merge)
+{
+  merge.clear();
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Compute the goodness of a merge *******************************************/
+template <typename M>
+int merge_goodness(const M& merge)
+{
+  // One fewer than the number of set elements in the merge
+  return ((int) merge.count()) - 1;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Get the entry resulting from a merge **************************************/
+template <typename T, typename M>
+RoutingTable::Entry merge_entries(const T& table,
+                                         const M& merge)
+{
+  // Iterate through the table, combining the entries.
+  uint32_t any_ones = 0x00000000;  // Where there is a one in ANY of the keys
+  uint32_t all_ones = 0xffffffff;  // Where there is a one in ALL of the keys
+  uint32_t all_sels = 0xffffffff;  // Where there is a one in ALL of the masks
+  uint32_t sources  = 0x00000000;  // Union of the source fields
+
+  // Union of the route fields (we rely on the caller to ensure what they are
+  // doing is valid!)
+  uint32_t routes   = 0x00000000;
+
+  for (auto i : merge.set_bits())
+  {
+    // Get the entry
+    auto entry = get_entry(table, i);
+
+    // Include in the values
+    any_ones |= entry.keymask.key;
+    all_ones &= entry.keymask.key;
+    all_sels &= entry.keymask.mask;
+    sources  |= entry.source;
+    routes   |= entry.route;
+  }
+
+  // Compute the new key and mask
+  auto any_zeros = ~all_ones;
+  auto new_xs = any_ones ^ any_zeros;
+  auto mask = all_sels & new_xs;  // Combine existing and new Xs
+  auto key = all_ones & mask;
+
+  // Create and return the new entry
+  return {{key, mask}, sources, routes};
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Determine where a new entry should be inserted in a routing table *********/
+// For a given generality, as an offset
+inline unsigned int get_insertion_offset(
+  const GeneralityIndex& index,
+  const unsigned int generality
+)
+{
+  // New entries are inserted after every entry of the same generality, that
+  // is at the start of the next generality.
+  return index.offsets[generality + 1];
+}
+
+// For a given entry, as an offset
+inline unsigned int get_insertion_offset(
+  const GeneralityIndex& index,
+  const RoutingTable::Entry& entry
+)
+{
+  return get_insertion_offset(index, entry.keymask.count_xs());
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Apply a merge *************************************************************/
+template <typename T, typename A, typename M>
+void merge_apply(T& table,
+                 GeneralityIndex& generality,
+                 A& aliases,
+                 const M& merge)
+{
+  // Get the merged entry and where to insert it in the table.
+  auto merge_entry = merge_entries(table, merge);
+  const unsigned int insertion_point = get_insertion_offset(generality,
+                                                            merge_entry);
+
+  // Update the generality index while the merged entries are still present.
+  generality_index_apply(generality, table, merge, merge_entry);
+
+  // Keep track of the size of the finished table.
+  const unsigned int size = table.size();
+  unsigned int final_size = size + 1;
+
+  // Use two indices to move through the table, copying elements from one
+  // position to the other as required.
+  unsigned int insert = 0;
+  for (unsigned int remove = 0; remove < size; remove++)
+  {
+    // Insert the new entry if this is the correct point at which to do so.
+    if (remove == insertion_point)
+    {
+      set_entry(table, insert, merge_entry);
+      insert++;
+    }
+
+    if (!merge[remove])
+    {
+      // If this entry is not part of the merge then copy it across to the new
+      // table.
+      set_entry(table, insert, get_entry(table, remove));
+      insert++;
+    }
+    else
+    {
+      // Update the aliases table; if the entry we're removing is in the
+      // aliases list then move all entries from its entry to the new entry, if
+      // it isn't then add just the keymask from the old entry to the aliases
+      // table.
+      aliases.replace(merge_entry.keymask, get_keymask(table, remove));
+
+      // Count this entry as removed.
+      final_size--;
+    }
+  }
+
+  // If inserting beyond the old end of the table then perform the insertion at
+  // the new end of the table.
+  if (insertion_point == size)
+  {
+    set_entry(table, insert, merge_entry);
+  }
+
+  // Resize the table (this will only ever be a shrink of the table).
+  table.resize(final_size);
+}
+
+template <typename M, typename V>
+void get_new_indices(const M& merge,
+                     const unsigned int insertion_point,
+                     V& new_index)
+{
+  // Entries move up by the number of merged entries above them and down by
+  // one if they lie at or below the insertion point of the new entry.
+  new_index.resize(merge.size() + 1);
+  unsigned int removed = 0;
+  for (unsigned int i = 0; i <= merge.size(); i++)
+  {
+    new_index[i] = i - removed + (i >= insertion_point ? 1 : 0);
+    if (i < merge.size() && merge[i])
+    {
+      removed++;
+    }
+  }
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Generality index **********************************************************/
+template <typename T>
+GeneralityIndex get_generality_index(const T& table)
+{
+  // Count the entries of each generality and then accumulate the counts into
+  // offsets.
+  GeneralityIndex index = {{0}};
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    index.offsets[get_keymask(table, i).count_xs() + 1]++;
+  }
+  for (unsigned int g = 1; g < 34; g++)
+  {
+    index.offsets[g] += index.offsets[g - 1];
+  }
+
+  return index;
+}
+
+template <typename T, typename M>
+void generality_index_apply(GeneralityIndex& index,
+                            const T& table,
+                            const M& merge,
+                            const RoutingTable::Entry& merge_entry)
+{
+  // Count the change in the number of entries of each generality
+  int delta[34] = {0};
+  for (auto i : merge.set_bits())
+  {
+    delta[get_keymask(table, i).count_xs() + 1]--;
+  }
+  delta[merge_entry.keymask.count_xs() + 1]++;
+
+  // Every offset moves by the total change in the entries of lower
+  // generalities.
+  int shift = 0;
+  for (unsigned int g = 1; g < 34; g++)
+  {
+    shift += delta[g];
+    index.offsets[g] += shift;
+  }
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Avoid covering entries with a merge ***************************************/
+struct CoverInfo
+{
+  // If any key-masks lower in the table than the entry resulting from the
+  // merge were covered
+  bool covers;
+  uint32_t set_to_zero;  // Bits which could be set to 0 to avoid the cover
+  uint32_t set_to_one;   // Bits which could be set to 1 to avoid the cover
+
+  // NOTE: If both the uint32_t s are zero and the bool is true then it is not
+  // possible to avoid the cover.
+};
+
+inline void get_settables(RoutingTable::KeyMask& a,
+                          RoutingTable::KeyMask& b,
+                          unsigned int& stringency,
+                          uint32_t& set_to_zero,
+                          uint32_t& set_to_one)
+{
+  // We can avoid merging by setting to either 0 or 1 bits where the
+  // merged entry has an X but the covered entry does not.
+  uint32_t settable = a.get_xs() & ~b.get_xs();
+
+  // Compute the stringency of this collision; if it's less than the
+  // previous stringency then reset the set_to_x variables; if it's more
+  // then disregard and if it's equal then update them.
+  unsigned int this_stringency = __builtin_popcount(settable);
+
+  if (this_stringency < stringency)
+  {
+    stringency  = this_stringency;
+    set_to_one  = settable & ~b.key;
+    set_to_zero = settable & b.key;
+  }
+  else if (this_stringency == stringency)
+  {
+    set_to_one  |= settable & ~b.key;
+    set_to_zero |= settable & b.key;
+  }
+}
+
+// Find whether the entry which would be generated by a merge covers any entry
+// below the point where it would be inserted, and which bits of the merged
+// entry could be set to avoid the cover.
+template <typename T, typename A, typename S = NoStats>
+struct CoverInfo get_cover_info(
+    const T& table,
+    const GeneralityIndex& generality,
+    const A& aliases,
+    const RoutingTable::Entry& merge_entry,
+    S&& stats = S()
+)
+{
+  struct CoverInfo info = {false, 0x0, 0x0};
+  auto merge_km = merge_entry.keymask;
+
+  unsigned int stringency = 33;  // Number of bits which MAY be set
+
+  // Look through the table to see if there are entries below the point where
+  // the merge would be inserted which would be covered by the entry resulting
+  // from performing the merge.
+  const unsigned int insertion_point =
+    get_insertion_offset(generality, merge_entry);
+  unsigned int tests = 0;
+  Intersect::for_each(table, insertion_point, table.size(), merge_km,
+    [&] (unsigned int i)
+    {
+      // Get the entry key-mask
+      auto entry_km = get_keymask(table, i);
+
+      // See if the key-mask is in the aliases table
+      auto alias_list = aliases.lookup(entry_km);
+      stats.count(ALIASES_SCANNED, alias_list.size());
+      if (alias_list.empty())
+      {
+        // As there are no aliases we need to avoid colliding with the key-mask
+        // from the entry.
+        info.covers = true;
+        get_settables(merge_km, entry_km, stringency,
+                      info.set_to_zero, info.set_to_one);
+      }
+      else
+      {
+        // As this key-mask is in the aliases table then check that none of the
+        // aliased key-masks intersect with the key-mask resulting from the
+        // merge.
+        for (auto alias : alias_list)
+        {
+          if (alias.intersect(merge_km))
+          {
+            info.covers = true;
+            get_settables(merge_km, alias, stringency,
+                          info.set_to_zero, info.set_to_one);
+          }
+        }
+      }
+    },
+    tests
+  );
+  stats.count(INTERSECT_TESTS, tests);
+
+  return info;
+}
+
+// Remove from a merge, and from the accumulated entry of the merge, every
+// entry whose key-mask satisfies f. Returns the number of entries removed.
+template <typename T, typename M, typename F>
+unsigned int merge_remove_if(
+    const T& table,
+    M& merge,
+    MergeAccumulator& accumulated,
+    F f
+)
+{
+  unsigned int removed = 0;
+  for (auto j : merge.set_bits())
+  {
+    if (f(get_keymask(table, j)))
+    {
+      merge.reset(j);
+      accumulated.remove(get_entry(table, j));
+      removed++;
+    }
+  }
+
+  return removed;
+}
+
+template <typename T, typename A, typename M, typename S>
+int refine_merge_downcheck(
+    const T& table,
+    const GeneralityIndex& generality,
+    const A& aliases,
+    M& merge,
+    const int min_goodness,
+    S&& stats
+)
+{
+  auto timer = stats.time(DOWNCHECK);
+  int removed = 0;                       // Count number of removed entries
+  int goodness = merge_goodness(merge);  // Original merge goodness
+
+  // The entry resulting from the merge, kept up to date as entries are
+  // removed from the merge.
+  auto accumulated = MergeAccumulator(table, merge);
+
+  while (goodness > min_goodness)
+  {
+    // Determine if any covering occurs
+    stats.count(DOWNCHECK_ROUNDS);
+    auto info = get_cover_info(table, generality, aliases,
+                               accumulated.entry(), stats);
+    if (!info.covers)
+    {
+      // If there was no covering then we can break out of this loop
+      break;
+    }
+
+    if (!info.set_to_one && !info.set_to_zero)
+    {
+      // We cannot do anything to avoid covering the lower entries, so abandon
+      // the merge entirely.
+      merge_clear(merge);
+      removed += goodness + 1;
+      goodness = 0;
+    }
+    else
+    {
+      // Find the smallest number of entries we could remove to set one of the
+      // bits in the merged entry such that it would avoid covering a lower
+      // entry. The number of entries to remove for each bit is known from the
+      // counts kept by the accumulator, so only the best set of entries to
+      // remove is found in the merge.
+      unsigned int best_count = 0;  // Entries to remove, 0 if none found
+      uint32_t best_bit = 0x0;      // Bit to set
+      bool best_to_one = false;     // If the bit is to be set to one
+      auto consider = [&] (unsigned int count, uint32_t bit, bool to_one)
+      {
+        if ((best_count == 0 || count < best_count) && count != 0)
+        {
+          best_count = count;
+          best_bit = bit;
+          best_to_one = to_one;
+        }
+      };
+
+      for (int b = 31; b >= 0 && best_count != 1; b--)
+      {
+        // If this bit may be set to zero then every entry with an X or a 1
+        // in the bit would have to be removed, if it may be set to one then
+        // every entry without a 1 in the bit.
+        const uint32_t bit = 1u << b;
+        if (bit & info.set_to_zero)
+        {
+          consider(accumulated.size() - accumulated.zeros(b), bit, false);
+        }
+        if (bit & info.set_to_one)
+        {
+          consider(accumulated.size() - accumulated.ones(b), bit, true);
+        }
+      }
+
+      // Remove the entries which prevent the chosen bit being set
+      const unsigned int n_removed = merge_remove_if(table, merge, accumulated,
+        [best_bit, best_to_one] (auto km) -> bool
+        {
+          if (best_to_one)
+          {
+            return ~km.key & best_bit;
+          }
+          return (~km.mask & best_bit) || (km.key & best_bit);
+        }
+      );
+      removed += n_removed;
+      goodness -= n_removed;
+
+      if (goodness == 0)
+      {
+        merge_clear(merge);
+        removed++;
+      }
+    }
+  }
+
+  stats.count(DOWNCHECK_REMOVED, removed);
+  return removed;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Avoid being covered by merging ********************************************/
+template <typename T, typename M, typename S>
+int refine_merge_upcheck(
+    const T& table,
+    const GeneralityIndex& generality,
+    M& merge,
+    const int min_goodness,
+    S&& stats
+)
+{
+  auto timer = stats.time(UPCHECK);
+  int
+    removed = 0,                       // Count number of removed entries
+    goodness = merge_goodness(merge);  // Original merge goodness
+
+  // Get the insertion position of the merge in the table, the entry
+  // resulting from the merge is kept up to date as entries are removed.
+  auto accumulated = MergeAccumulator(table, merge);
+  unsigned int insertion_point =
+    get_insertion_offset(generality, accumulated.entry());
+
+  // For each entry in the merge (in decreasing order of generality) check to
+  // see if there are any entries above the merge position which would cause
+  // the entry to become covered if the merge were to go ahead.
+  // Abort this process once the goodness of the merge is no greater than the
+  // specified minimum goodness.
+  for (auto index = merge.find_last();
+       index != M::npos && goodness > min_goodness;
+       index = merge.find_prev(index))
+  {
+    // Get the key-mask of this entry
+    auto entry_km = get_keymask(table, index);
+
+    // Check to see if any entry between the current entry position and the
+    // position where the merge will be inserted would partially or wholly
+    // cover the entry. If it would then remove the entry from the merge.
+    stats.count(UPCHECK_ROUNDS);
+    unsigned int tests = 0;
+    const unsigned int hit = Intersect::find_first(table, index + 1,
+                                                   insertion_point, entry_km,
+                                                   tests);
+    stats.count(INTERSECT_TESTS, tests);
+    if (hit < insertion_point)
+    {
+      // This entry would become covered if the merge were to go ahead so
+      // remove it from the merge.
+      removed++;
+      goodness--;
+      merge.reset(index);
+      accumulated.remove(get_entry(table, index));
+
+      // Recompute where the entry resulting from the merge would be inserted
+      // in the table.
+      insertion_point =
+        get_insertion_offset(generality, accumulated.entry());
+    }
+  }
+
+  // If the merge is now no better than the specified minimum goodness empty
+  // the merge and return.
+  if (goodness <= min_goodness)
+  {
+    // Empty the merge entirely
+    merge_clear(merge);
+    removed += goodness;
+    goodness = 0;
+  }
+
+  stats.count(UPCHECK_REMOVED, removed);
+  return removed;
+}
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Refine a merge ************************************************************/
+template <typename T, typename A, typename M, typename S>
+int refine_merge(
+    const T& table,
+    const GeneralityIndex& generality,
+    const A& aliases,
+    M& merge,
+    const int min_goodness,
+    S&& stats
+)
+{
+  int goodness = merge_goodness(merge);
+
+  // Remove entries such that it would not cover any existing entries.
+  int removed = refine_merge_downcheck(table, generality, aliases, merge,
+                                       min_goodness, stats);
+
+  if (goodness - removed > min_goodness)
+  {
+    // Remove entries which would be covered by any existing entries.
+    int up_removed = refine_merge_upcheck(table, generality, merge,
+                                          min_goodness, stats);
+    removed += up_removed;
+
+    // If entries were removed then the down-check needs to be recomputed.
+    if (up_removed && goodness - removed > min_goodness)
+    {
+      removed += refine_merge_downcheck(table, generality, aliases, merge,
+                                        min_goodness, stats);
+    }
+  }
+
+  return removed;
+}
+/*****************************************************************************/
+}
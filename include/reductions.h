@@ -0,0 +1,87 @@
+#include <unordered_set>
+#include <vector>
+
+#include "keymask_trie.h"
+#include "routing_table.h"
+#include "soa_table.h"
+
+#pragma once
+
+namespace Reductions
+{
+/*****************************************************************************/
+/* Table reductions **********************************************************/
+// Cheap reductions which remove entries that can never match a packet, so
+// that a minimiser starts from the smallest equivalent table. Neither changes
+// the routing of any key nor the order of the remaining entries, so a table
+// sorted by generality remains sorted. Tables may be either a Table or a
+// SoATable. See also DefaultRoutes::minimise.
+
+// Determine if every key matched by key-mask b is also matched by key-mask a,
+// a key-mask with a 1 in its key outside its mask matches no keys.
+inline bool covers(const RoutingTable::KeyMask& a,
+                   const RoutingTable::KeyMask& b)
+{
+  return !(a.key & ~a.mask) && !(a.mask & ~b.mask) &&
+         !((a.key ^ b.key) & a.mask);
+}
+
+// Remove the marked entries from a table, keeping the order of the rest
+template <typename T>
+void remove_marked(T& table, const std::vector<char>& marked)
+{
+  unsigned int insert = 0;
+  for (unsigned int remove = 0; remove < table.size(); remove++)
+  {
+    if (!marked[remove])
+    {
+      set_entry(table, insert++, get_entry(table, remove));
+    }
+  }
+  table.resize(insert);
+}
+
+// Remove every entry whose key-mask is identical to that of an entry higher in
+// the table; packets matching it are routed by the higher entry.
+template <typename T>
+void remove_duplicates(T& table)
+{
+  auto seen = std::unordered_set<RoutingTable::KeyMask>(table.size());
+  auto marked = std::vector<char>(table.size(), false);
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    marked[i] = !seen.insert(get_keymask(table, i)).second;
+  }
+  remove_marked(table, marked);
+}
+
+// Remove every entry whose key-mask is covered by that of a single entry
+// higher in the table, which includes every duplicate. The table is swept
+// from the top down, indexing the key-masks of the entries kept so far, so
+// that each entry is checked only against key-masks sharing a prefix with its
+// own. An entry covered by a removed entry is also covered by the entry which
+// covered that, so removed entries need not be indexed.
+template <typename T>
+void remove_shadowed(T& table)
+{
+  auto kept = RoutingTable::KeyMaskTrie();
+  auto marked = std::vector<char>(table.size(), false);
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    const auto km = get_keymask(table, i);
+    marked[i] = !kept.for_each_intersecting(km,
+      [&km] (const RoutingTable::KeyMask& other, unsigned int)
+      {
+        return !covers(other, km);
+      }
+    );
+
+    if (!marked[i])
+    {
+      kept.insert(km, i);
+    }
+  }
+  remove_marked(table, marked);
+}
+/*****************************************************************************/
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "keymask_trie.h"
+#include "routing_table.h"
+#include "soa_table.h"
+
+#pragma once
+
+namespace RoutePartition
+{
+/*****************************************************************************/
+/* Route-partition minimisation **********************************************/
+// A much cheaper, if less thorough, alternative to Ordered Covering. The
+// entries of a table are partitioned by route and, within each partition,
+// pairs of entries whose key-masks differ in exactly one bit (which neither
+// has as an X) are replaced by a single entry with an X in that bit. Repeating
+// this until no such pairs remain merges any complete power-of-two block of
+// key-masks with the same route.
+//
+// The merged entry matches exactly the keys matched by the pair, so no
+// aliases need be recorded. It takes the place of the higher entry of the
+// pair, and a pair is only merged if no entry with another route lies between
+// them and intersects the lower entry, so every key is routed as before. The
+// entries in between are found using a trie of the key-masks of the table.
+//
+// Tables may be either a Table or a SoATable and need not be sorted.
+
+// Minimise a table until it is no longer than the target length or no pair
+// of entries may be merged.
+template <typename T>
+void minimise(T& table, unsigned int target_length);
+
+// Merge the entries at positions p and q > p of a table, which must differ only
+// in one bit of their key-masks, if the merge would not change how any key is
+// routed. Returns true if the entries were merged, in which case the merged
+// entry is at p and the entry at q is marked as removed.
+template <typename T>
+bool merge_pair(T& table,
+                RoutingTable::KeyMaskTrie& keymasks,
+                std::vector<char>& removed,
+                unsigned int p,
+                unsigned int q);
+/*****************************************************************************/
+
+
+/*****************************************************************************/
+/* Implementation ************************************************************/
+template <typename T>
+bool merge_pair(T& table,
+                RoutingTable::KeyMaskTrie& keymasks,
+                std::vector<char>& removed,
+                unsigned int p,
+                unsigned int q)
+{
+  const auto upper = get_entry(table, p);
+  const auto lower = get_entry(table, q);
+
+  // Packets matching the lower entry which would have been routed by an
+  // entry between the two must continue to be.
+  const bool blocked = !keymasks.for_each_intersecting(lower.keymask, p + 1, q,
+    [&table, &lower] (const RoutingTable::KeyMask&, unsigned int i)
+    {
+      return get_route(table, i) == lower.route;
+    }
+  );
+  if (blocked)
+  {
+    return false;
+  }
+
+  // The bit in which the key-masks differ becomes an X
+  const uint32_t bit = upper.keymask.key ^ lower.keymask.key;
+  const RoutingTable::Entry merged = {
+    {upper.keymask.key & ~bit, upper.keymask.mask & ~bit},
+    upper.source | lower.source, upper.route
+  };
+
+  keymasks.erase(upper.keymask, p);
+  keymasks.erase(lower.keymask, q);
+  keymasks.insert(merged.keymask, p);
+  set_entry(table, p, merged);
+  removed[q] = true;
+  return true;
+}
+
+template <typename T>
+void minimise(T& table, unsigned int target_length)
+{
+  auto keymasks = RoutingTable::KeyMaskTrie();
+  auto partitions = std::map<uint32_t, std::vector<unsigned int>>();
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    keymasks.insert(get_keymask(table, i), i);
+    partitions[get_route(table, i)].push_back(i);
+  }
+
+  auto removed = std::vector<char>(table.size(), false);
+  auto touched = std::vector<char>(table.size(), false);
+  auto sorted = std::vector<std::pair<RoutingTable::KeyMask, unsigned int>>();
+  unsigned int length = table.size();
+
+  // Each pass merges every pair it can find amongst the entries present at
+  // the start of the pass, an entry is merged at most once per pass. Merged
+  // entries may be merged again in the next pass.
+  bool merged = true;
+  while (merged && length > target_length)
+  {
+    merged = false;
+    std::fill(touched.begin(), touched.end(), false);
+
+    for (auto& partition : partitions)
+    {
+      // Sort the partition by key-mask so that the entry differing from
+      // another in a given bit may be found by binary search.
+      auto& members = partition.second;
+      sorted.clear();
+      for (auto i : members)
+      {
+        sorted.push_back({get_keymask(table, i), i});
+      }
+      std::sort(sorted.begin(), sorted.end());
+
+      for (unsigned int m = 0; m < members.size() &&
+                               length > target_length; m++)
+      {
+        const unsigned int i = members[m];
+        if (touched[i])
+        {
+          continue;
+        }
+
+        const auto km = get_keymask(table, i);
+        for (uint32_t bit = 1; bit && !touched[i]; bit <<= 1)
+        {
+          if (!(km.mask & bit))
+          {
+            continue;
+          }
+
+          const RoutingTable::KeyMask other = {km.key ^ bit, km.mask};
+          for (auto match = std::lower_bound(sorted.begin(), sorted.end(),
+                                             std::make_pair(other, 0u));
+               match != sorted.end() && match->first == other;
+               match++)
+          {
+            const unsigned int j = match->second;
+            if (!touched[j] &&
+                merge_pair(table, keymasks, removed,
+                           std::min(i, j), std::max(i, j)))
+            {
+              touched[i] = touched[j] = true;
+              merged = true;
+              length--;
+              break;
+            }
+          }
+        }
+      }
+
+      members.erase(std::remove_if(members.begin(), members.end(),
+                                   [&removed] (auto i) { return removed[i]; }),
+                    members.end());
+    }
+  }
+
+  // Remove the merged-away entries, keeping the rest in order
+  unsigned int insert = 0;
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    if (!removed[i])
+    {
+      set_entry(table, insert++, get_entry(table, i));
+    }
+  }
+  table.resize(insert);
+}
+/*****************************************************************************/
+}
@@ -1,71 +1,69 @@
+#include <stddef.h>
 #include <stdint.h>
+#include <functional>
 #include <vector>
 
+#include "routing_entry.h"
+
 #pragma once
 
 namespace RoutingTable
 {
 
 /*****************************************************************************/
-/* Key-Mask ******************************************************************/
-struct KeyMask
-{
-  uint32_t key;
-  uint32_t mask;
-
-  // True if two keymasks would match any of the same keys
-  bool intersect(const KeyMask& b) const
-  {
-    return (this->key & b.mask) == (b.key & this->mask);
-  }
-
-  // Apply an ordering to key-masks for use with maps
-  bool operator<(const KeyMask& b) const
-  {
-
-      uint64_t i_a = (((uint64_t) this->key) << 32) | ((uint64_t) this->mask);
-      uint64_t i_b = (((uint64_t) b.key) << 32) | ((uint64_t) b.mask);
+/* Routing Table *************************************************************/
+// See routing_entry.h for the KeyMask and Entry types, which do not depend on
+// the standard library.
+typedef std::vector<Entry> Table;  // Routing tables are just vectors
+/*****************************************************************************/
 
-      return i_a < i_b;
-  }
+/*****************************************************************************/
+/* Layout-independent access *************************************************/
+// The minimisers are templated on the table layout and access entries through
+// these functions, see soa_table.h for the structure-of-arrays equivalents.
+inline KeyMask get_keymask(const Table& table, size_t i)
+{
+  return table[i].keymask;
+}
 
-  bool operator==(const KeyMask& b) const
-  {
-    return (this->key == b.key && this->mask == b.mask);
-  }
+inline uint32_t get_route(const Table& table, size_t i)
+{
+  return table[i].route;
+}
 
-  // Get a mask indicating the presence of Xs in a key-mask
-  uint32_t get_xs() const
-  {
-    return ~this->mask & ~this->key;
-  }
+inline Entry get_entry(const Table& table, size_t i)
+{
+  return table[i];
+}
 
-  // Count the number of Xs in a key-mask pair
-  unsigned int count_xs() const
-  {
-    const uint32_t xs = this->get_xs();
-    return __builtin_popcount(xs);
-  }
-};
+inline void set_entry(Table& table, size_t i, const Entry& entry)
+{
+  table[i] = entry;
+}
 /*****************************************************************************/
 
+}
+
 /*****************************************************************************/
-/* Routing Table Entry *******************************************************/
-struct Entry
+/* Key-Mask hashing **********************************************************/
+namespace std
 {
-  KeyMask keymask;  // Key and mask for the entry
-  uint32_t source;  // Routes by which packets may arrive at the router
-  uint32_t route;   // Routes by which matching packets will be sent
-
-  bool operator ==(const Entry& b) const
+template <>
+struct hash<RoutingTable::KeyMask>
+{
+  size_t operator()(const RoutingTable::KeyMask& km) const
   {
-    return (this->source == b.source &&
-            this->route == b.route &&
-            this->keymask == b.keymask);
+    // Mix the 64-bit concatenation of the key and mask (the MurmurHash3
+    // finaliser) so that every input bit affects every output bit; key-masks
+    // in a routing table typically differ in only a few low bits.
+    uint64_t h = (((uint64_t) km.key) << 32) | ((uint64_t) km.mask);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t) h;
   }
 };
-
-typedef std::vector<Entry> Table;  // Routing tables are just vectors
-/*****************************************************************************/
-
 }
+/*****************************************************************************/
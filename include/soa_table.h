@@ -0,0 +1,174 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+#include "intersect.h"
+#include "routing_table.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Cache-line aligned allocator **********************************************/
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  AlignedAllocator() {}
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t n)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+    {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t)
+  {
+    free(p);
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const
+  {
+    return false;
+  }
+};
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Structure-of-arrays routing table *****************************************/
+// A routing table with each field of the entries held in a separate array.
+// The scans performed by the minimisers only read the keys and masks, and
+// grouping only reads the routes, so with this layout every cache line
+// fetched contains only data which will be used. Each array is aligned to a
+// cache line.
+struct SoATable
+{
+  typedef std::vector<uint32_t, AlignedAllocator<uint32_t>> Field;
+
+  Field keys;
+  Field masks;
+  Field sources;
+  Field routes;
+
+  SoATable() {}
+
+  explicit SoATable(size_t size)
+  {
+    resize(size);
+  }
+
+  explicit SoATable(const Table& table)
+  {
+    resize(table.size());
+    for (size_t i = 0; i < table.size(); i++)
+    {
+      keys[i] = table[i].keymask.key;
+      masks[i] = table[i].keymask.mask;
+      sources[i] = table[i].source;
+      routes[i] = table[i].route;
+    }
+  }
+
+  // Convert back into an array-of-structures table
+  Table to_table() const
+  {
+    auto table = Table(size());
+    for (size_t i = 0; i < size(); i++)
+    {
+      table[i] = {{keys[i], masks[i]}, sources[i], routes[i]};
+    }
+    return table;
+  }
+
+  size_t size() const
+  {
+    return keys.size();
+  }
+
+  void resize(size_t size)
+  {
+    keys.resize(size);
+    masks.resize(size);
+    sources.resize(size);
+    routes.resize(size);
+  }
+
+  void swap(SoATable& b)
+  {
+    keys.swap(b.keys);
+    masks.swap(b.masks);
+    sources.swap(b.sources);
+    routes.swap(b.routes);
+  }
+
+  bool operator==(const SoATable& b) const
+  {
+    return (keys == b.keys && masks == b.masks &&
+            sources == b.sources && routes == b.routes);
+  }
+};
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Layout-independent access *************************************************/
+inline KeyMask get_keymask(const SoATable& table, size_t i)
+{
+  return {table.keys[i], table.masks[i]};
+}
+
+inline uint32_t get_route(const SoATable& table, size_t i)
+{
+  return table.routes[i];
+}
+
+inline Entry get_entry(const SoATable& table, size_t i)
+{
+  return {{table.keys[i], table.masks[i]}, table.sources[i], table.routes[i]};
+}
+
+inline void set_entry(SoATable& table, size_t i, const Entry& entry)
+{
+  table.keys[i] = entry.keymask.key;
+  table.masks[i] = entry.keymask.mask;
+  table.sources[i] = entry.source;
+  table.routes[i] = entry.route;
+}
+
+// Get the intersection bitmap of a block of up to 64 entries, see
+// Intersect::get_hits
+inline uint64_t get_hits(const SoATable& table,
+                         unsigned int begin,
+                         unsigned int n,
+                         const KeyMask km)
+{
+  return Intersect::get_soa_kernel()(table.keys.data() + begin,
+                                     table.masks.data() + begin, n, km);
+}
+/*****************************************************************************/
+
+}
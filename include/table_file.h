@@ -0,0 +1,874 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "routing_table.h"
+
+#pragma once
+
+namespace RoutingTable
+{
+
+/*****************************************************************************/
+/* Binary routing table files ************************************************/
+// Files come in two formats, both with every field in the native
+// (little-endian) byte order. A legacy file is a sequence of records, one per
+// routing table:
+//
+//   BYTE x, BYTE y, SHORT length, `length` Entries
+//
+// A container starts with an 8-byte magic number and version, and is followed
+// by a record per routing table, an end record holding a table of contents and
+// the offset of the end record:
+//
+//   BYTE magic[7] = "\x89RTABLE", BYTE version = 1
+//   for each table:
+//     BYTE x, BYTE y, BYTE encoding, BYTE 0, WORD length, WORD size,
+//     WORD checksum, `size` bytes of data, zeros to a multiple of 4 bytes
+//   BYTE 0, BYTE 0, BYTE END, BYTE 0, WORD n_tables, WORD 16 * n_tables,
+//   WORD checksum
+//   for each table:
+//     BYTE x, BYTE y, SHORT 0, WORD length, DOUBLEWORD offset of its record
+//   DOUBLEWORD offset of the end record
+//
+// The data of a table holds its `length` entries either as they are (RAW) or
+// compressed (DELTA, see encode_entries). Checksums are the CRC-32 of the data
+// or table of contents they follow. The table of contents allows a table to be
+// found without reading the ones before it, and the record headers allow a
+// container to be read from a stream.
+//
+// Readers tell the formats apart by the magic number; a legacy file whose
+// first table is at (137, 82) and has 16724 entries is indistinguishable from
+// a container by its first four bytes but not by its first eight.
+
+enum Format
+{
+  LEGACY,     // Records without a header, of at most 65535 entries
+  CONTAINER,  // Records with a table of contents and checksums
+};
+
+// Encodings of the data of a container record
+enum Encoding
+{
+  RAW = 0,    // The entries as they are
+  DELTA = 1,  // The entries compressed by encode_entries
+  END = 255,  // Not a table: the table of contents
+};
+
+const unsigned char CONTAINER_MAGIC[8] = {
+  0x89, 'R', 'T', 'A', 'B', 'L', 'E', 1,
+};
+
+// Header of a record in a container
+struct ContainerRecord
+{
+  uint8_t x, y;
+  uint8_t encoding;
+  uint8_t reserved;
+  uint32_t length;    // Number of entries, or of tables for the end record
+  uint32_t size;      // Bytes of data following the header, before padding
+  uint32_t checksum;  // CRC-32 of the data
+};
+
+// Entry of the table of contents of a container
+struct ContainerTocEntry
+{
+  uint8_t x, y;
+  uint16_t reserved;
+  uint32_t length;  // Number of entries in the table
+  uint64_t offset;  // Offset of the record of the table from the file start
+};
+
+// Compute the CRC-32 (as used by zlib) of a block of data, continuing from the
+// CRC of any preceding data.
+inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0)
+{
+  static const auto table = [] ()
+  {
+    auto table = std::vector<uint32_t>(256);
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for (unsigned int k = 0; k < 8; k++)
+      {
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  const auto* bytes = (const unsigned char*) data;
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Compress entries by storing each field XORed with the same field of the
+// previous entry as a little-endian base-128 varint. Neighbouring entries of
+// a table tend to share masks, sources and routes and most bits of their keys
+// so most fields take a single byte. The data is appended to `out`.
+inline void encode_entries(const Entry* entries,
+                           uint32_t length,
+                           std::vector<char>& out)
+{
+  uint32_t previous[4] = {0, 0, 0, 0};
+  for (uint32_t i = 0; i < length; i++)
+  {
+    const uint32_t fields[4] = {
+      entries[i].keymask.key, entries[i].keymask.mask,
+      entries[i].source, entries[i].route,
+    };
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      uint32_t value = fields[f] ^ previous[f];
+      previous[f] = fields[f];
+      while (value >= 0x80)
+      {
+        out.push_back((char) (0x80 | (value & 0x7f)));
+        value >>= 7;
+      }
+      out.push_back((char) value);
+    }
+  }
+}
+
+// Decompress entries compressed by encode_entries, returning false if the
+// data does not hold exactly `length` entries.
+inline bool decode_entries(const unsigned char* data,
+                           size_t size,
+                           uint32_t length,
+                           Entry* entries)
+{
+  const unsigned char* end = data + size;
+  uint32_t previous[4] = {0, 0, 0, 0};
+  for (uint32_t i = 0; i < length; i++)
+  {
+    uint32_t fields[4];
+    for (unsigned int f = 0; f < 4; f++)
+    {
+      uint32_t value = 0;
+      for (unsigned int shift = 0; ; shift += 7)
+      {
+        if (data == end || shift > 28)
+        {
+          return false;
+        }
+
+        const unsigned char byte = *data++;
+        value |= (uint32_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+          break;
+        }
+      }
+      fields[f] = previous[f] ^= value;
+    }
+    entries[i] = {{fields[0], fields[1]}, fields[2], fields[3]};
+  }
+  return data == end;
+}
+
+// Read-only view of a routing table within a file
+struct TableView
+{
+  unsigned char x, y;      // Co-ordinates of the chip
+  uint32_t length;         // Number of entries
+  const Entry* entries;    // The entries, valid while the file is open
+
+  // Copy the entries into a table which may be modified
+  Table to_table() const
+  {
+    return Table(entries, entries + length);
+  }
+};
+
+// Write a routing table record to a stream in the legacy format
+inline void write_table(std::ostream& out,
+                        unsigned char x,
+                        unsigned char y,
+                        const Entry* entries,
+                        unsigned short length)
+{
+  out.write((const char *) &x, 1);
+  out.write((const char *) &y, 1);
+  out.write((const char *) &length, 2);
+  out.write((const char *) entries, sizeof(Entry) * length);
+}
+
+// A file of routing tables, in either format, mapped into memory. Every record
+// is validated when the file is opened and each table is exposed as a view of
+// the mapping, so tables are only copied if they are to be modified or were
+// compressed. Errors opening the file or malformed records are reported by
+// throwing std::runtime_error.
+class MappedTableFile
+{
+  public:
+    explicit MappedTableFile(const char* path) :
+      m_data(nullptr), m_size(0), m_format(LEGACY)
+    {
+      int fd = open(path, O_RDONLY);
+      if (fd < 0)
+      {
+        throw std::runtime_error(std::string(path) + ": " + strerror(errno));
+      }
+
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+      {
+        auto error = std::string(path) + ": " + strerror(errno);
+        close(fd);
+        throw std::runtime_error(error);
+      }
+
+      // Empty files cannot be mapped but contain no tables anyway
+      m_size = st.st_size;
+      if (m_size)
+      {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+          auto error = std::string(path) + ": " + strerror(errno);
+          close(fd);
+          throw std::runtime_error(error);
+        }
+        m_data = (const unsigned char*) data;
+        madvise(data, m_size, MADV_SEQUENTIAL);
+      }
+      close(fd);
+
+      try
+      {
+        if (m_size >= sizeof(CONTAINER_MAGIC) &&
+            !memcmp(m_data, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC)))
+        {
+          m_format = CONTAINER;
+          index_container(path);
+        }
+        else
+        {
+          index(path);
+        }
+        index_coordinates();
+      }
+      catch (...)
+      {
+        unmap();
+        throw;
+      }
+    }
+
+    ~MappedTableFile()
+    {
+      unmap();
+    }
+
+    MappedTableFile(const MappedTableFile&) = delete;
+    MappedTableFile& operator=(const MappedTableFile&) = delete;
+
+    // Number of tables in the file
+    size_t size() const
+    {
+      return m_tables.size();
+    }
+
+    Format format() const
+    {
+      return m_format;
+    }
+
+    const TableView& operator[](size_t i) const
+    {
+      return m_tables[i];
+    }
+
+    std::vector<TableView>::const_iterator begin() const
+    {
+      return m_tables.begin();
+    }
+
+    std::vector<TableView>::const_iterator end() const
+    {
+      return m_tables.end();
+    }
+
+    // Get the first table for the chip at (x, y), or nullptr if there is none
+    const TableView* find(unsigned char x, unsigned char y) const
+    {
+      const uint16_t key = x << 8 | y;
+      auto p = std::lower_bound(
+        m_coordinates.begin(), m_coordinates.end(), std::make_pair(key, 0u)
+      );
+      return p != m_coordinates.end() && p->first == key ?
+        &m_tables[p->second] : nullptr;
+    }
+
+  private:
+    enum : size_t { HEADER_SIZE = 4 };
+
+    // Validate the records and construct a view of each table
+    void index(const char* path)
+    {
+      size_t offset = 0;
+      while (offset < m_size)
+      {
+        if (m_size - offset < HEADER_SIZE)
+        {
+          throw std::runtime_error(
+            std::string(path) + ": truncated table header at byte " +
+            std::to_string(offset)
+          );
+        }
+
+        TableView view;
+        unsigned short length;
+        view.x = m_data[offset];
+        view.y = m_data[offset + 1];
+        memcpy(&length, m_data + offset + 2, 2);
+        view.length = length;
+        offset += HEADER_SIZE;
+
+        const size_t size = sizeof(Entry) * view.length;
+        if (m_size - offset < size)
+        {
+          throw std::runtime_error(
+            std::string(path) + ": table (" + std::to_string(view.x) + ", " +
+            std::to_string(view.y) + ") has " + std::to_string(view.length) +
+            " entries but only " + std::to_string(m_size - offset) +
+            " bytes remain"
+          );
+        }
+
+        // Records start on a 4-byte boundary so the entries are suitably
+        // aligned to be read in place.
+        view.entries = (const Entry*) (m_data + offset);
+        offset += size;
+        m_tables.push_back(view);
+      }
+    }
+
+    // Validate the table of contents and every record it refers to, and
+    // construct a view of each table.
+    void index_container(const char* path)
+    {
+      auto malformed = [path] (const std::string& what)
+      {
+        return std::runtime_error(std::string(path) + ": " + what);
+      };
+
+      // Find the end record from the offset at the end of the file
+      const size_t min_size = sizeof(CONTAINER_MAGIC) +
+                              sizeof(ContainerRecord) + sizeof(uint64_t);
+      uint64_t end_offset;
+      if (m_size < min_size)
+      {
+        throw malformed("truncated container");
+      }
+      memcpy(&end_offset, m_data + m_size - sizeof(end_offset),
+             sizeof(end_offset));
+
+      ContainerRecord end;
+      if (end_offset < sizeof(CONTAINER_MAGIC) ||
+          end_offset > m_size - sizeof(ContainerRecord) - sizeof(uint64_t))
+      {
+        throw malformed("bad table of contents offset");
+      }
+      memcpy(&end, m_data + end_offset, sizeof(end));
+
+      const size_t toc_offset = end_offset + sizeof(end);
+      const size_t toc_size = (size_t) end.length * sizeof(ContainerTocEntry);
+      if (end.encoding != END || end.size != toc_size ||
+          toc_offset + toc_size + sizeof(uint64_t) != m_size)
+      {
+        throw malformed("malformed table of contents");
+      }
+      if (crc32(m_data + toc_offset, toc_size) != end.checksum)
+      {
+        throw malformed("table of contents checksum mismatch");
+      }
+
+      m_decoded.reserve(end.length);
+      for (uint32_t t = 0; t < end.length; t++)
+      {
+        ContainerTocEntry entry;
+        memcpy(&entry, m_data + toc_offset + t * sizeof(entry), sizeof(entry));
+        const std::string name = "table (" + std::to_string(entry.x) + ", " +
+                                 std::to_string(entry.y) + ")";
+
+        // The record must lie before the end record and agree with its entry
+        // in the table of contents. An empty container's end record directly
+        // follows the magic number so the offset is checked without
+        // subtracting from end_offset. Records are written on a 4-byte
+        // boundary, which raw entries rely on to be read in place.
+        ContainerRecord record;
+        if (entry.offset < sizeof(CONTAINER_MAGIC) ||
+            entry.offset % alignof(Entry) != 0 ||
+            entry.offset > end_offset ||
+            end_offset - entry.offset < sizeof(record))
+        {
+          throw malformed(name + " has a bad offset");
+        }
+        memcpy(&record, m_data + entry.offset, sizeof(record));
+
+        const size_t data_offset = entry.offset + sizeof(record);
+        if (record.x != entry.x || record.y != entry.y ||
+            record.length != entry.length || record.size > end_offset ||
+            data_offset > end_offset - record.size)
+        {
+          throw malformed(name + " does not match the table of contents");
+        }
+
+        const unsigned char* data = m_data + data_offset;
+        if (crc32(data, record.size) != record.checksum)
+        {
+          throw malformed(name + " checksum mismatch");
+        }
+
+        TableView view = {record.x, record.y, record.length, nullptr};
+        if (record.encoding == RAW &&
+            record.size == (uint64_t) sizeof(Entry) * record.length)
+        {
+          // Records start on a 4-byte boundary so the entries are suitably
+          // aligned to be read in place.
+          view.entries = (const Entry*) data;
+        }
+        else if (record.encoding == DELTA &&
+                 record.length <= record.size)  // Entries take >= 4 bytes
+        {
+          m_decoded.emplace_back(record.length);
+          if (!decode_entries(data, record.size, record.length,
+                              m_decoded.back().data()))
+          {
+            throw malformed(name + " is corrupt");
+          }
+          view.entries = m_decoded.back().data();
+        }
+        else
+        {
+          throw malformed(name + " has an unknown encoding or bad size");
+        }
+        m_tables.push_back(view);
+      }
+    }
+
+    // Sort the co-ordinates of the tables so that they may be looked up
+    void index_coordinates()
+    {
+      m_coordinates.reserve(m_tables.size());
+      for (unsigned int i = 0; i < m_tables.size(); i++)
+      {
+        const uint16_t key = m_tables[i].x << 8 | m_tables[i].y;
+        m_coordinates.push_back({key, i});
+      }
+      std::sort(m_coordinates.begin(), m_coordinates.end());
+    }
+
+    void unmap()
+    {
+      if (m_data)
+      {
+        munmap((void*) m_data, m_size);
+        m_data = nullptr;
+      }
+    }
+
+    const unsigned char* m_data;  // Start of the mapping
+    size_t m_size;                // Length of the file
+    Format m_format;
+    std::vector<TableView> m_tables;
+    std::vector<Table> m_decoded;  // Decompressed tables
+
+    // The co-ordinates (x << 8 | y) of every table and its position, sorted
+    std::vector<std::pair<uint16_t, unsigned int>> m_coordinates;
+};
+
+// Reads routing tables, in either format, one at a time from a stream such as
+// a pipe. Records are validated as they are read and malformed records are
+// reported by throwing std::runtime_error.
+class TableReader
+{
+  public:
+    TableReader(FILE* file, const std::string& name) :
+      m_file(file), m_name(name), m_offset(0), m_format(LEGACY),
+      m_started(false), m_finished(false), m_tables(0) {}
+
+    // Read the next table, returning false at the end of the stream
+    bool next(unsigned char& x, unsigned char& y, Table& table)
+    {
+      if (!m_started)
+      {
+        start();
+      }
+      if (m_finished)
+      {
+        return false;
+      }
+      return m_format == CONTAINER ? next_container(x, y, table)
+                                   : next_legacy(x, y, table);
+    }
+
+    // Get the format of the stream, which is known once a table (or the end
+    // of the stream) has been read.
+    Format format() const
+    {
+      return m_format;
+    }
+
+  private:
+    // Determine the format of the stream from its first bytes. Any bytes read
+    // which turn out not to be a magic number are read again as a table.
+    void start()
+    {
+      m_started = true;
+      unsigned char magic[sizeof(CONTAINER_MAGIC)];
+      const size_t n_magic = read_some(magic, sizeof(magic));
+      if (n_magic == sizeof(magic) &&
+          !memcmp(magic, CONTAINER_MAGIC, sizeof(magic)))
+      {
+        m_format = CONTAINER;
+      }
+      else
+      {
+        m_pending.assign(magic, magic + n_magic);
+        m_offset -= n_magic;
+      }
+    }
+
+    bool next_legacy(unsigned char& x, unsigned char& y, Table& table)
+    {
+      unsigned char header[4];
+      const size_t n_header = read_some(header, sizeof(header));
+      if (n_header == 0)
+      {
+        return false;
+      }
+      else if (n_header < sizeof(header))
+      {
+        throw std::runtime_error(
+          m_name + ": truncated table header at byte " +
+          std::to_string(m_offset - n_header)
+        );
+      }
+
+      unsigned short length;
+      x = header[0];
+      y = header[1];
+      memcpy(&length, header + 2, 2);
+
+      table.resize(length);
+      const size_t n_entries = read_some(table.data(),
+                                         sizeof(Entry) * length) /
+                               sizeof(Entry);
+      if (n_entries < length)
+      {
+        throw std::runtime_error(
+          m_name + ": table (" + std::to_string(x) + ", " + std::to_string(y) +
+          ") has " + std::to_string(length) + " entries but only " +
+          std::to_string(n_entries) + " could be read"
+        );
+      }
+
+      return true;
+    }
+
+    bool next_container(unsigned char& x, unsigned char& y, Table& table)
+    {
+      ContainerRecord record;
+      read_all(&record, sizeof(record), "truncated record header");
+      x = record.x;
+      y = record.y;
+      const std::string name = "table (" + std::to_string(x) + ", " +
+                               std::to_string(y) + ")";
+
+      if (record.encoding == END)
+      {
+        // The table of contents is checked but not used
+        if (record.length != m_tables ||
+            record.size != record.length * sizeof(ContainerTocEntry))
+        {
+          throw std::runtime_error(m_name +
+                                   ": malformed table of contents");
+        }
+        read_data(record.size + sizeof(uint64_t),
+                  "truncated table of contents");
+        if (crc32(m_data.data(), record.size) != record.checksum)
+        {
+          throw std::runtime_error(m_name +
+                                   ": table of contents checksum mismatch");
+        }
+        m_finished = true;
+        return false;
+      }
+
+      // Data is padded to a multiple of four bytes. Tables are only
+      // compressed if that makes them smaller.
+      const uint64_t raw_size = (uint64_t) sizeof(Entry) * record.length;
+      if ((record.encoding != RAW && record.encoding != DELTA) ||
+          (record.encoding == RAW && record.size != raw_size) ||
+          (record.encoding == DELTA &&
+           (record.length > record.size || record.size >= raw_size)))
+      {
+        throw std::runtime_error(m_name + ": " + name +
+                                 " has an unknown encoding or bad size");
+      }
+      read_data((record.size + 3) & ~(size_t) 3, name + " is truncated");
+      if (crc32(m_data.data(), record.size) != record.checksum)
+      {
+        throw std::runtime_error(m_name + ": " + name + " checksum mismatch");
+      }
+
+      table.resize(record.length);
+      if (record.encoding == RAW)
+      {
+        memcpy(table.data(), m_data.data(), record.size);
+      }
+      else if (!decode_entries(m_data.data(), record.size, record.length,
+                               table.data()))
+      {
+        throw std::runtime_error(m_name + ": " + name + " is corrupt");
+      }
+
+      m_tables++;
+      return true;
+    }
+
+    // Read up to `size` bytes, returning the number read
+    size_t read_some(void* data, size_t size)
+    {
+      auto* bytes = (unsigned char*) data;
+      const size_t n_pending = std::min(size, m_pending.size());
+      std::copy(m_pending.begin(), m_pending.begin() + n_pending, bytes);
+      m_pending.erase(m_pending.begin(), m_pending.begin() + n_pending);
+
+      const size_t n = n_pending + fread(bytes + n_pending, 1,
+                                         size - n_pending, m_file);
+      if (ferror(m_file))
+      {
+        throw std::runtime_error(m_name + ": " + strerror(errno));
+      }
+      m_offset += n;
+      return n;
+    }
+
+    // Read exactly `size` bytes, or report what was being read
+    void read_all(void* data, size_t size, const std::string& what)
+    {
+      const size_t offset = m_offset;
+      if (read_some(data, size) < size)
+      {
+        throw std::runtime_error(m_name + ": " + what + " at byte " +
+                                 std::to_string(offset));
+      }
+    }
+
+    // Read exactly `size` bytes into m_data. The buffer grows only as data
+    // arrives so that a corrupt size in a truncated stream cannot cause a
+    // huge allocation.
+    void read_data(size_t size, const std::string& what)
+    {
+      const size_t chunk = 1 << 20;
+      m_data.clear();
+      while (m_data.size() < size)
+      {
+        const size_t offset = m_data.size();
+        m_data.resize(offset + std::min(chunk, size - offset));
+        read_all(m_data.data() + offset, m_data.size() - offset, what);
+      }
+    }
+
+    FILE* m_file;
+    std::string m_name;
+    size_t m_offset;  // Bytes read so far
+    Format m_format;
+    bool m_started;   // True once the format is known
+    bool m_finished;  // True once the end of a container has been read
+    uint32_t m_tables;  // Tables read so far
+    std::vector<unsigned char> m_pending;  // Bytes to read before the stream
+    std::vector<unsigned char> m_data;     // Data of the current record
+};
+
+// Writes routing tables to a stream, in either format, collecting records into
+// large blocks so that the stream is written with as few calls as possible.
+// Containers may compress the tables; each table is stored compressed only if
+// that makes it smaller. Errors are reported by throwing std::runtime_error.
+class TableWriter
+{
+  public:
+    enum : size_t { BLOCK_SIZE = 1 << 20 };
+
+    TableWriter(FILE* file,
+                const std::string& name,
+                Format format = LEGACY,
+                bool compress = false) :
+      m_file(file), m_name(name), m_format(format), m_compress(compress),
+      m_offset(0)
+    {
+      m_buffer.reserve(BLOCK_SIZE);
+      if (m_format == CONTAINER)
+      {
+        append(CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC));
+      }
+    }
+
+    ~TableWriter()
+    {
+      // Errors cannot be reported here, call close to check for them
+      if (!m_buffer.empty())
+      {
+        fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+      }
+    }
+
+    TableWriter(const TableWriter&) = delete;
+    TableWriter& operator=(const TableWriter&) = delete;
+
+    void write(unsigned char x,
+               unsigned char y,
+               const Entry* entries,
+               uint32_t length)
+    {
+      if (m_format == CONTAINER)
+      {
+        write_record(x, y, entries, length);
+      }
+      else
+      {
+        if (length > 0xffff)
+        {
+          throw std::runtime_error(
+            m_name + ": table (" + std::to_string(x) + ", " +
+            std::to_string(y) + ") has " + std::to_string(length) +
+            " entries, more than a legacy file may hold"
+          );
+        }
+
+        const unsigned short short_length = length;
+        m_buffer.push_back(x);
+        m_buffer.push_back(y);
+        append(&short_length, 2);
+        append(entries, sizeof(Entry) * length);
+      }
+
+      if (m_buffer.size() >= BLOCK_SIZE)
+      {
+        write_buffer();
+      }
+    }
+
+    // Write out any buffered tables and flush the stream
+    void flush()
+    {
+      write_buffer();
+      if (fflush(m_file) != 0)
+      {
+        throw std::runtime_error(m_name + ": " + strerror(errno));
+      }
+    }
+
+    // Write the table of contents of a container, after which no more tables
+    // may be written, and flush the stream. A container is incomplete until
+    // it has been closed.
+    void close()
+    {
+      if (m_format == CONTAINER)
+      {
+        const uint64_t end_offset = m_offset;
+        const uint32_t toc_size = m_toc.size() * sizeof(ContainerTocEntry);
+        const ContainerRecord end = {
+          0, 0, END, 0, (uint32_t) m_toc.size(), toc_size,
+          crc32(m_toc.data(), toc_size),
+        };
+        append(&end, sizeof(end));
+        append(m_toc.data(), toc_size);
+        append(&end_offset, sizeof(end_offset));
+        m_toc.clear();
+      }
+      flush();
+    }
+
+  private:
+    void write_record(unsigned char x,
+                      unsigned char y,
+                      const Entry* entries,
+                      uint32_t length)
+    {
+      const size_t raw_size = sizeof(Entry) * length;
+      const void* data = entries;
+      uint8_t encoding = RAW;
+      if (m_compress)
+      {
+        m_compressed.clear();
+        encode_entries(entries, length, m_compressed);
+        if (m_compressed.size() < raw_size)
+        {
+          data = m_compressed.data();
+          encoding = DELTA;
+        }
+      }
+
+      const size_t stored = encoding == RAW ? raw_size : m_compressed.size();
+      if (stored > UINT32_MAX)
+      {
+        throw std::runtime_error(
+          m_name + ": table (" + std::to_string(x) + ", " + std::to_string(y) +
+          ") is too large"
+        );
+      }
+      const uint32_t size = stored;
+
+      m_toc.push_back({x, y, 0, length, m_offset});
+      const ContainerRecord record = {
+        x, y, encoding, 0, length, size, crc32(data, size),
+      };
+      append(&record, sizeof(record));
+      append(data, size);
+
+      const char padding[4] = {0, 0, 0, 0};
+      append(padding, (4 - size % 4) % 4);
+    }
+
+    void append(const void* data, size_t size)
+    {
+      const auto* bytes = (const char*) data;
+      m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+      m_offset += size;
+    }
+
+    void write_buffer()
+    {
+      if (fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) !=
+          m_buffer.size())
+      {
+        m_buffer.clear();
+        throw std::runtime_error(m_name + ": " + strerror(errno));
+      }
+      m_buffer.clear();
+    }
+
+    FILE* m_file;
+    std::string m_name;
+    Format m_format;
+    bool m_compress;
+    uint64_t m_offset;              // Bytes written or buffered so far
+    std::vector<char> m_buffer;     // Records not yet written
+    std::vector<char> m_compressed;  // Data of the current record
+    std::vector<ContainerTocEntry> m_toc;  // Records written so far
+};
+/*****************************************************************************/
+
+}
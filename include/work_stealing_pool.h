@@ -0,0 +1,203 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma once
+
+namespace Parallel
+{
+
+/*****************************************************************************/
+/* Work-stealing thread pool *************************************************/
+// A fixed set of worker threads which execute batches of independent tasks.
+// The tasks of a batch are dealt round-robin onto a queue per worker; each
+// worker takes tasks from the front of its own queue and, once that is empty,
+// steals from the back of the queues of the other workers. Listing the tasks
+// in decreasing order of cost therefore starts the most expensive tasks first
+// and leaves only cheap tasks to be stolen at the end of a batch.
+class WorkStealingPool
+{
+  public:
+    // Create a pool of n_workers workers, the thread calling run is one of
+    // the workers so n_workers - 1 threads are started.
+    explicit WorkStealingPool(unsigned int n_workers) :
+      m_queues(n_workers ? n_workers : 1), m_remaining(0),
+      m_generation(0), m_stop(false)
+    {
+      for (unsigned int i = 1; i < m_queues.size(); i++)
+      {
+        m_threads.emplace_back([this, i] () { worker(i); });
+      }
+    }
+
+    ~WorkStealingPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_wake.notify_all();
+
+      for (auto& thread : m_threads)
+      {
+        thread.join();
+      }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned int size() const
+    {
+      return m_queues.size();
+    }
+
+    // Call f(task) once for every task in tasks and wait for every call to
+    // complete. If any call throws then the first exception is rethrown once
+    // the remaining tasks have finished.
+    template <typename F>
+    void run(const std::vector<unsigned int>& tasks, F f)
+    {
+      if (tasks.empty())
+      {
+        return;
+      }
+
+      m_function = f;
+      m_error = nullptr;
+      m_remaining = tasks.size();
+
+      // Deal the tasks to the workers
+      for (unsigned int i = 0; i < tasks.size(); i++)
+      {
+        auto& queue = m_queues[i % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(tasks[i]);
+      }
+
+      // Wake the workers and join in
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+      }
+      m_wake.notify_all();
+      drain(0);
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] () { return m_remaining == 0; });
+      }
+
+      m_function = nullptr;
+      if (m_error)
+      {
+        std::rethrow_exception(m_error);
+      }
+    }
+
+  private:
+    struct Queue
+    {
+      std::mutex mutex;
+      std::deque<unsigned int> tasks;
+    };
+
+    void worker(const unsigned int id)
+    {
+      unsigned int generation = 0;
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_wake.wait(lock, [this, generation] () {
+            return m_stop || m_generation != generation;
+          });
+          if (m_stop)
+          {
+            return;
+          }
+          generation = m_generation;
+        }
+
+        drain(id);
+      }
+    }
+
+    // Execute tasks until every queue is empty
+    void drain(const unsigned int id)
+    {
+      unsigned int task;
+      while (take(id, task))
+      {
+        try
+        {
+          m_function(task);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (!m_error)
+          {
+            m_error = std::current_exception();
+          }
+        }
+
+        if (--m_remaining == 0)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_done.notify_all();
+        }
+      }
+    }
+
+    // Get a task from the front of our own queue or steal one from the back
+    // of another queue, return false if there are no tasks left.
+    bool take(const unsigned int id, unsigned int& task)
+    {
+      {
+        auto& queue = m_queues[id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+          task = queue.tasks.front();
+          queue.tasks.pop_front();
+          return true;
+        }
+      }
+
+      for (unsigned int i = 1; i < m_queues.size(); i++)
+      {
+        auto& queue = m_queues[(id + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+          task = queue.tasks.back();
+          queue.tasks.pop_back();
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    std::vector<Queue> m_queues;  // Tasks waiting for each worker
+    std::vector<std::thread> m_threads;
+    std::function<void(unsigned int)> m_function;  // Task of the current batch
+    std::exception_ptr m_error;  // First exception raised by the batch
+    std::atomic<unsigned int> m_remaining;  // Unfinished tasks in the batch
+
+    std::mutex m_mutex;  // Guards the following
+    std::condition_variable m_wake;  // Signalled when a batch starts
+    std::condition_variable m_done;  // Signalled when a batch completes
+    unsigned int m_generation;  // Number of batches started
+    bool m_stop;
+};
+/*****************************************************************************/
+
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <vector>
+#include "alias_table.h"
+
+using OrderedCovering::AliasTable;
+using RoutingTable::KeyMask;
+
+
+class AliasTableTest : public ::testing::Test
+{
+};
+
+
+// Get the aliases of a key-mask as a set
+static std::set<KeyMask> get_set(const AliasTable& aliases, const KeyMask& km)
+{
+  auto range = aliases.lookup(km);
+  return std::set<KeyMask>(range.begin(), range.end());
+}
+
+
+TEST(AliasTableTest, test_insert_and_lookup)
+{
+  auto aliases = AliasTable();
+  EXPECT_EQ(aliases.size(), 0);
+  EXPECT_TRUE(aliases.lookup({0x0, 0xe}).empty());
+
+  aliases.insert({0x0, 0xe}, {0x0, 0xf});
+  aliases.insert({0x2, 0xe}, {0x2, 0xf});
+  aliases.insert({0x0, 0xe}, {0x1, 0xf});
+
+  EXPECT_EQ(aliases.size(), 2);
+  EXPECT_EQ(aliases.count({0x0, 0xe}), 1);
+  EXPECT_EQ(aliases.count({0x0, 0xf}), 0);
+  EXPECT_EQ(get_set(aliases, {0x0, 0xe}),
+            std::set<KeyMask>({{0x0, 0xf}, {0x1, 0xf}}));
+  EXPECT_EQ(get_set(aliases, {0x2, 0xe}), std::set<KeyMask>({{0x2, 0xf}}));
+}
+
+
+TEST(AliasTableTest, test_replace)
+{
+  // Replacing a key-mask without aliases adds it as an alias
+  auto aliases = AliasTable();
+  aliases.replace({0x0, 0xe}, {0x0, 0xf});
+  aliases.replace({0x0, 0xe}, {0x1, 0xf});
+  EXPECT_EQ(aliases.size(), 1);
+  EXPECT_EQ(get_set(aliases, {0x0, 0xe}),
+            std::set<KeyMask>({{0x0, 0xf}, {0x1, 0xf}}));
+
+  // Replacing a key-mask with aliases moves them to the new key-mask
+  aliases.insert({0x2, 0xe}, {0x2, 0xf});
+  aliases.insert({0x2, 0xe}, {0x3, 0xf});
+  aliases.replace({0x0, 0xc}, {0x0, 0xe});
+  aliases.replace({0x0, 0xc}, {0x2, 0xe});
+
+  EXPECT_EQ(aliases.size(), 1);
+  EXPECT_EQ(aliases.count({0x0, 0xe}), 0);
+  EXPECT_EQ(aliases.count({0x2, 0xe}), 0);
+  EXPECT_EQ(get_set(aliases, {0x0, 0xc}),
+            std::set<KeyMask>({{0x0, 0xf}, {0x1, 0xf},
+                               {0x2, 0xf}, {0x3, 0xf}}));
+}
+
+
+TEST(AliasTableTest, test_erase_and_grow)
+{
+  // Insert enough key-masks to force the table to grow several times and
+  // erase some of them to leave deleted slots in the probe sequences.
+  auto aliases = AliasTable();
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    aliases.insert({i << 1, 0xfffffffe}, {i << 1, 0xffffffff});
+    aliases.insert({i << 1, 0xfffffffe}, {(i << 1) | 1, 0xffffffff});
+  }
+  for (uint32_t i = 0; i < 1000; i += 2)
+  {
+    aliases.erase({i << 1, 0xfffffffe});
+  }
+
+  EXPECT_EQ(aliases.size(), 500);
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    KeyMask km = {i << 1, 0xfffffffe};
+    if (i % 2)
+    {
+      EXPECT_EQ(get_set(aliases, km),
+                std::set<KeyMask>({{i << 1, 0xffffffff},
+                                   {(i << 1) | 1, 0xffffffff}}));
+    }
+    else
+    {
+      EXPECT_EQ(aliases.count(km), 0);
+    }
+  }
+}
+
+
+TEST(AliasTableTest, test_convert_aliases)
+{
+  // Converting to and from the map-based representation should be lossless
+  OrderedCovering::Aliases expected;
+  expected[{0x0, 0xe}] = {{0x0, 0xf}, {0x1, 0xf}};
+  expected[{0x8, 0x8}] = {{0x8, 0xf}, {0xa, 0xf}, {0xc, 0xc}};
+
+  auto aliases = AliasTable(expected);
+  EXPECT_EQ(aliases.size(), 2);
+  EXPECT_EQ(aliases.to_aliases(), expected);
+}
+
+
+TEST(AliasTableTest, test_replace_and_compact)
+{
+  // Repeatedly merge key-masks together, as minimise does, so that the arena
+  // is compacted many times, checking the aliases against a map of sets.
+  std::mt19937 rng(17);
+  auto aliases = AliasTable();
+  auto expected = OrderedCovering::Aliases();
+  auto live = std::vector<KeyMask>();
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    live.push_back({i, 0xffffffff});
+  }
+
+  for (uint32_t i = 0; live.size() > 1; i++)
+  {
+    // Replace two key-masks with a new one
+    const KeyMask new_km = {i, 0x7fffffff};
+    for (unsigned int j = 0; j < 2; j++)
+    {
+      const unsigned int k = rng() % live.size();
+      const KeyMask old_km = live[k];
+      live[k] = live.back();
+      live.pop_back();
+
+      aliases.replace(new_km, old_km);
+      if (expected.count(old_km))
+      {
+        expected[new_km].insert(expected[old_km].begin(),
+                                expected[old_km].end());
+        expected.erase(old_km);
+      }
+      else
+      {
+        expected[new_km].insert(old_km);
+      }
+    }
+    live.push_back(new_km);
+
+    ASSERT_EQ(aliases.to_aliases(), expected);
+  }
+
+  aliases.clear();
+  EXPECT_EQ(aliases.size(), 0);
+  EXPECT_TRUE(aliases.to_aliases().empty());
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "bit_vector.h"
+
+using RoutingTable::BitVector;
+
+
+class BitVectorTest : public ::testing::Test
+{
+};
+
+
+TEST(BitVectorTest, test_construct_and_count)
+{
+  // An empty vector
+  auto a = BitVector(130);
+  EXPECT_EQ(a.size(), 130);
+  EXPECT_EQ(a.count(), 0);
+  EXPECT_TRUE(a.none());
+
+  // A full vector (spanning three words)
+  auto b = BitVector(130, true);
+  EXPECT_EQ(b.size(), 130);
+  EXPECT_EQ(b.count(), 130);
+  EXPECT_TRUE(b[0]);
+  EXPECT_TRUE(b[129]);
+
+  // From a list of values
+  BitVector c = {true, false, true, true};
+  EXPECT_EQ(c.size(), 4);
+  EXPECT_EQ(c.count(), 3);
+  EXPECT_TRUE(c[0]);
+  EXPECT_FALSE(c[1]);
+}
+
+
+TEST(BitVectorTest, test_set_reset_maintains_count)
+{
+  auto a = BitVector(200);
+
+  // Setting bits increments the count, setting them twice does not
+  a[3] = true;
+  a.set(64);
+  a.set(64);
+  a[199] = a[0] = true;
+  EXPECT_EQ(a.count(), 4);
+  EXPECT_TRUE(a[0]);
+  EXPECT_TRUE(a[3]);
+  EXPECT_TRUE(a[64]);
+  EXPECT_TRUE(a[199]);
+
+  // Resetting bits decrements the count, resetting them twice does not
+  a[3] = false;
+  a.reset(64);
+  a.reset(64);
+  EXPECT_EQ(a.count(), 2);
+  EXPECT_FALSE(a[3]);
+  EXPECT_FALSE(a[64]);
+
+  // Clearing empties the vector but retains its length
+  a.clear();
+  EXPECT_EQ(a.count(), 0);
+  EXPECT_EQ(a.size(), 200);
+  EXPECT_FALSE(a[0]);
+  EXPECT_FALSE(a[199]);
+}
+
+
+TEST(BitVectorTest, test_resize)
+{
+  auto a = BitVector(60, true);
+
+  // Growing with set bits crosses into a new word
+  a.resize(70, true);
+  EXPECT_EQ(a.count(), 70);
+
+  // Growing with clear bits
+  a.resize(140);
+  EXPECT_EQ(a.count(), 70);
+  EXPECT_FALSE(a[139]);
+
+  // Shrinking discards set bits
+  a.resize(65);
+  EXPECT_EQ(a.count(), 65);
+  a.resize(140);
+  EXPECT_EQ(a.count(), 65);
+  EXPECT_FALSE(a[65]);
+}
+
+
+TEST(BitVectorTest, test_find_and_iterate)
+{
+  auto a = BitVector(300);
+  EXPECT_EQ(a.find_first(), BitVector::npos);
+  EXPECT_EQ(a.find_last(), BitVector::npos);
+
+  const std::vector<size_t> bits = {1, 63, 64, 128, 250, 299};
+  for (auto i : bits)
+  {
+    a.set(i);
+  }
+
+  // Iterate forwards over the set bits
+  auto found = std::vector<size_t>();
+  for (auto i : a.set_bits())
+  {
+    found.push_back(i);
+  }
+  EXPECT_EQ(found, bits);
+
+  // Iterate backwards over the set bits
+  found.clear();
+  for (auto i = a.find_last(); i != BitVector::npos; i = a.find_prev(i))
+  {
+    found.insert(found.begin(), i);
+  }
+  EXPECT_EQ(found, bits);
+
+  EXPECT_EQ(a.find_next(299), BitVector::npos);
+  EXPECT_EQ(a.find_prev(1), BitVector::npos);
+  EXPECT_EQ(a.find_next(64), 128);
+  EXPECT_EQ(a.find_prev(128), 64);
+}
+
+
+TEST(BitVectorTest, test_bitwise_operations)
+{
+  BitVector a = {true, true, false, false};
+  BitVector b = {true, false, true, false};
+
+  auto c = a;
+  c &= b;
+  EXPECT_EQ(c, BitVector({true, false, false, false}));
+  EXPECT_EQ(c.count(), 1);
+
+  c = a;
+  c |= b;
+  EXPECT_EQ(c, BitVector({true, true, true, false}));
+  EXPECT_EQ(c.count(), 3);
+
+  c = a;
+  c.and_not(b);
+  EXPECT_EQ(c, BitVector({false, true, false, false}));
+  EXPECT_EQ(c.count(), 1);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+
+using Parallel::BoundedQueue;
+
+
+class BoundedQueueTest : public ::testing::Test
+{
+};
+
+
+TEST(BoundedQueueTest, test_priority_order)
+{
+  // Items should be removed highest priority first
+  BoundedQueue<int> queue(8);
+  for (int i : {3, 1, 4, 1, 5, 9, 2, 6})
+  {
+    EXPECT_TRUE(queue.push(i));
+  }
+
+  auto popped = std::vector<int>();
+  queue.close();
+  for (int i = 0; queue.pop(i); )
+  {
+    popped.push_back(i);
+  }
+  EXPECT_EQ(popped, std::vector<int>({9, 6, 5, 4, 3, 2, 1, 1}));
+}
+
+
+TEST(BoundedQueueTest, test_close)
+{
+  // Nothing may be added to a closed queue and waiting consumers are woken
+  BoundedQueue<int> queue(2);
+  EXPECT_TRUE(queue.push(1));
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+
+  int i = 0;
+  EXPECT_TRUE(queue.pop(i));
+  EXPECT_EQ(i, 1);
+  EXPECT_FALSE(queue.pop(i));
+}
+
+
+TEST(BoundedQueueTest, test_producers_and_consumers)
+{
+  // Items passing between threads should be neither lost nor duplicated and
+  // the queue should never exceed its capacity.
+  BoundedQueue<int, std::greater<int>> queue(4);
+  std::atomic<int> sum(0), count(0);
+
+  auto consumers = std::vector<std::thread>();
+  for (int c = 0; c < 3; c++)
+  {
+    consumers.emplace_back([&] () {
+      for (int i = 0; queue.pop(i); )
+      {
+        sum += i;
+        count++;
+      }
+    });
+  }
+
+  auto producers = std::vector<std::thread>();
+  for (int p = 0; p < 2; p++)
+  {
+    producers.emplace_back([&queue, p] () {
+      for (int i = 0; i < 1000; i++)
+      {
+        queue.push(p * 1000 + i);
+      }
+    });
+  }
+
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+  queue.close();
+  for (auto& consumer : consumers)
+  {
+    consumer.join();
+  }
+
+  EXPECT_EQ(count, 2000);
+  EXPECT_EQ(sum, 1999 * 2000 / 2);
+}
+
+
+TEST(BoundedQueueTest, test_semaphore)
+{
+  Parallel::Semaphore semaphore(2);
+  semaphore.acquire();
+  semaphore.acquire();
+
+  // A third acquisition must wait for a release
+  std::atomic<bool> acquired(false);
+  std::thread waiter([&] () {
+    semaphore.acquire();
+    acquired = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(acquired);
+
+  semaphore.release();
+  waiter.join();
+  EXPECT_TRUE(acquired);
+}
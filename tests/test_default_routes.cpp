@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <random>
 #include "default_routes.h"
 
 
@@ -63,3 +64,75 @@ TEST(DefaultRoutesTest, test_minimise_nonorthogonal_table)
   EXPECT_EQ(table[1].keymask.key, 0x0);
   EXPECT_EQ(table[1].keymask.mask, 0x8);
 }
+
+
+TEST(DefaultRoutesTest, test_minimise_soa_table)
+{
+  // Both table layouts should have the same entries removed
+  std::mt19937 rng(5);
+  for (unsigned int trial = 0; trial < 20; trial++)
+  {
+    auto table = RoutingTable::Table(100);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 1 << (rng() % 6);
+
+      // Make roughly half of the entries pass straight through the router
+      entry.route = rng() % 2 ? ((entry.source << 3) & 0x38) |
+                                ((entry.source >> 3) & 0x7)
+                              : 1 << (rng() % 6);
+    }
+    auto soa = RoutingTable::SoATable(table);
+
+    DefaultRoutes::minimise(table);
+    DefaultRoutes::minimise(soa);
+    EXPECT_EQ(soa.to_table(), table);
+  }
+}
+
+
+TEST(DefaultRoutesTest, test_minimise_matches_defaultable)
+{
+  // Minimising should remove exactly those entries which `defaultable`
+  // reports, both serially and when a large table is split between workers.
+  std::mt19937 rng(11);
+  Parallel::WorkStealingPool pool(3);
+  for (unsigned int length : {0u, 1u, 100u, 1000u, 20000u})
+  {
+    auto table = RoutingTable::Table(length);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xffff0000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 1 << (rng() % 6);
+
+      // Make most of the entries pass straight through the router
+      entry.route = rng() % 4 ? ((entry.source << 3) & 0x38) |
+                                ((entry.source >> 3) & 0x7)
+                              : 1 << (rng() % 8);
+    }
+
+    auto expected = RoutingTable::Table();
+    for (unsigned int i = 0; i < table.size(); i++)
+    {
+      if (!DefaultRoutes::defaultable(table, i))
+      {
+        expected.push_back(table[i]);
+      }
+    }
+
+    auto serial = table;
+    DefaultRoutes::minimise(serial);
+    EXPECT_EQ(serial, expected);
+
+    auto parallel = table;
+    DefaultRoutes::minimise(parallel, pool);
+    EXPECT_EQ(parallel, expected);
+
+    auto soa = RoutingTable::SoATable(table);
+    DefaultRoutes::minimise(soa, pool);
+    EXPECT_EQ(soa.to_table(), expected);
+  }
+}
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <gtest/gtest.h>
+#include "fixed_arena.h"
+
+using RoutingTable::Arena;
+using RoutingTable::ArenaVector;
+using RoutingTable::FixedArena;
+
+
+class FixedArenaTest : public ::testing::Test
+{
+};
+
+
+TEST(FixedArenaTest, test_allocate)
+{
+  // Allocations should be aligned and should not overlap
+  FixedArena<64> arena;
+  EXPECT_EQ(arena.capacity(), 64u);
+  EXPECT_EQ(arena.used(), 0u);
+
+  auto a = arena.allocate<uint8_t>(3);
+  auto b = arena.allocate<uint32_t>(2);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ((uintptr_t) a % Arena::ALIGNMENT, 0u);
+  EXPECT_EQ((uintptr_t) b % Arena::ALIGNMENT, 0u);
+  EXPECT_GE((uint8_t*) b, a + 3);
+  EXPECT_EQ(arena.used(), 16u);
+}
+
+
+TEST(FixedArenaTest, test_exhaustion)
+{
+  // An allocation which does not fit should return nullptr and leave the
+  // arena unchanged.
+  FixedArena<32> arena;
+  ASSERT_NE(arena.allocate(24), nullptr);
+  EXPECT_EQ(arena.allocate(9), nullptr);
+  EXPECT_EQ(arena.allocate<uint64_t>(2), nullptr);
+  EXPECT_EQ(arena.allocate<uint64_t>(SIZE_MAX / 4), nullptr);
+  EXPECT_EQ(arena.used(), 24u);
+  EXPECT_NE(arena.allocate(8), nullptr);
+  EXPECT_EQ(arena.allocate(0), arena.allocate(0));
+}
+
+
+TEST(FixedArenaTest, test_extend)
+{
+  // Only the most recent allocation may be extended, and only as far as the
+  // capacity allows.
+  FixedArena<64> arena;
+  auto a = arena.allocate<uint32_t>(2);
+  auto b = arena.allocate<uint32_t>(0);
+  EXPECT_FALSE(arena.extend(a, 4));
+  EXPECT_TRUE(arena.extend(b, 4));
+  EXPECT_EQ(arena.used(), 24u);
+  EXPECT_TRUE(arena.extend(b, 14));
+  EXPECT_FALSE(arena.extend(b, 15));
+  EXPECT_EQ(arena.used(), 64u);
+}
+
+
+TEST(FixedArenaTest, test_release_and_high_water)
+{
+  // Releasing to a mark should free the later allocations, the high-water
+  // mark should record the most ever used.
+  uint64_t storage[8];
+  Arena arena(storage, sizeof(storage));
+  arena.allocate(8);
+  const auto mark = arena.mark();
+  arena.allocate(40);
+  EXPECT_EQ(arena.high_water(), 48u);
+
+  arena.release(mark);
+  EXPECT_EQ(arena.used(), 8u);
+  EXPECT_EQ(arena.allocate(8), (void*) (storage + 1));
+  EXPECT_EQ(arena.high_water(), 48u);
+
+  arena.clear();
+  EXPECT_EQ(arena.used(), 0u);
+  EXPECT_EQ(arena.high_water(), 48u);
+  arena.reset_high_water();
+  EXPECT_EQ(arena.high_water(), 0u);
+}
+
+
+TEST(FixedArenaTest, test_arena_vector)
+{
+  // A vector should hold no more than its capacity, which may only be
+  // increased while it is the most recent allocation.
+  FixedArena<64> arena;
+  ArenaVector<uint32_t> a, b;
+  ASSERT_TRUE(a.allocate(arena, 2));
+  a.push_back(1);
+  a.push_back(2);
+  EXPECT_EQ(a.size(), 2u);
+  EXPECT_EQ(a.capacity(), 2u);
+  EXPECT_TRUE(a.reserve(4));
+  a.resize(4, 7);
+  EXPECT_EQ(a[1], 2u);
+  EXPECT_EQ(a.back(), 7u);
+
+  ASSERT_TRUE(b.allocate(arena, 4));
+  EXPECT_FALSE(a.reserve(5));
+  EXPECT_EQ(a.capacity(), 4u);
+  b = a;
+  EXPECT_TRUE(b == a);
+  b.pop_back();
+  EXPECT_FALSE(b == a);
+
+  EXPECT_FALSE(b.reserve(16));
+  EXPECT_TRUE(b.reserve(12));
+  EXPECT_EQ(arena.used(), 64u);
+
+  // There is no storage to give a vector once the arena is full
+  ArenaVector<uint32_t> c;
+  EXPECT_FALSE(c.allocate(arena, 1));
+  EXPECT_EQ(c.capacity(), 0u);
+}
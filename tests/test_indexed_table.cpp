@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "indexed_table.h"
+#include "soa_table.h"
+
+using RoutingTable::IndexedTable;
+using RoutingTable::KeyMask;
+
+
+class IndexedTableTest : public ::testing::Test
+{
+};
+
+
+TEST(IndexedTableTest, test_queries_match_table)
+{
+  // Range queries on an indexed table should give the same results as on the
+  // table itself, for both short (scanned) and long (indexed) ranges.
+  std::mt19937 rng(13);
+  auto table = RoutingTable::Table(5000);
+  for (auto& entry : table)
+  {
+    entry.keymask.mask = rng() | 0xffffe000;
+    entry.keymask.key = rng() & entry.keymask.mask;
+    entry.source = rng();
+    entry.route = rng();
+  }
+  auto soa = RoutingTable::SoATable(table);
+
+  IndexedTable<RoutingTable::Table> indexed(table);
+  IndexedTable<RoutingTable::SoATable> indexed_soa(soa);
+  EXPECT_EQ(indexed.size(), table.size());
+  EXPECT_EQ(indexed.keymasks().size(), table.size());
+  EXPECT_EQ(get_entry(indexed, 10), table[10]);
+  EXPECT_EQ(get_entry(indexed_soa, 10), table[10]);
+
+  for (unsigned int q = 0; q < 200; q++)
+  {
+    const uint32_t mask = rng() | (q % 2 ? 0xffffe000 : 0xffffff00);
+    const KeyMask km = {(uint32_t) rng() & mask, mask};
+    const unsigned int begin = rng() % table.size();
+    const unsigned int end = begin + rng() % (table.size() + 1 - begin);
+
+    const auto first = Intersect::find_first(table, begin, end, km);
+    EXPECT_EQ(Intersect::find_first(indexed, begin, end, km), first);
+    EXPECT_EQ(Intersect::find_first(indexed_soa, begin, end, km), first);
+
+    auto expected = std::vector<unsigned int>();
+    unsigned int scan_tests = 0;
+    Intersect::for_each(table, begin, end, km,
+                        [&] (unsigned int i) { expected.push_back(i); },
+                        scan_tests);
+    auto found = std::vector<unsigned int>();
+    unsigned int tests = 0;
+    Intersect::for_each(indexed, begin, end, km,
+                        [&] (unsigned int i) { found.push_back(i); }, tests);
+    EXPECT_EQ(found, expected);
+
+    // Long ranges test only the entries visited in the trie
+    if (end - begin <= Intersect::INDEXED_SCAN_LENGTH)
+    {
+      EXPECT_EQ(tests, scan_tests);
+    }
+    else
+    {
+      EXPECT_GE(tests, found.size());
+      EXPECT_LT(tests, scan_tests);
+    }
+  }
+}
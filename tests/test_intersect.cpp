@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "intersect.h"
+#include "routing_table.h"
+
+using RoutingTable::KeyMask;
+using RoutingTable::Table;
+
+
+class IntersectTest : public ::testing::Test
+{
+};
+
+
+// Generate a table of random key-masks drawn from a small key space so that a
+// reasonable proportion of them intersect.
+static Table random_table(std::mt19937& rng, unsigned int length)
+{
+  auto table = Table(length);
+  for (auto& entry : table)
+  {
+    entry.keymask.mask = rng() | 0xffffff00;
+    entry.keymask.key = rng() & entry.keymask.mask;
+    entry.source = rng();
+    entry.route = rng();
+  }
+  return table;
+}
+
+
+// Get every kernel which may be run on this processor
+static std::vector<Intersect::Kernel> get_kernels()
+{
+  auto kernels = std::vector<Intersect::Kernel>({Intersect::intersect_scalar});
+#ifdef RIG_INTERSECT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+  {
+    kernels.push_back(Intersect::intersect_sse2);
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    kernels.push_back(Intersect::intersect_avx2);
+  }
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    kernels.push_back(Intersect::intersect_avx512);
+  }
+#endif
+  return kernels;
+}
+
+
+TEST(IntersectTest, test_kernels_match_intersect)
+{
+  // Every kernel should agree with KeyMask::intersect for every block length
+  // and alignment.
+  std::mt19937 rng(1);
+  auto table = random_table(rng, 200);
+
+  for (auto kernel : get_kernels())
+  {
+    for (unsigned int trial = 0; trial < 200; trial++)
+    {
+      const KeyMask km = table[rng() % table.size()].keymask;
+      const unsigned int offset = rng() % (table.size() - 64);
+      const unsigned int n = trial % 65;
+
+      uint64_t expected = 0;
+      for (unsigned int i = 0; i < n; i++)
+      {
+        if (table[offset + i].keymask.intersect(km))
+        {
+          expected |= ((uint64_t) 1) << i;
+        }
+      }
+
+      EXPECT_EQ(kernel(table.data() + offset, n, km), expected);
+    }
+  }
+}
+
+
+TEST(IntersectTest, test_find_first_and_for_each)
+{
+  std::mt19937 rng(2);
+  auto table = random_table(rng, 300);
+
+  for (unsigned int trial = 0; trial < 200; trial++)
+  {
+    const KeyMask km = table[rng() % table.size()].keymask;
+    const unsigned int begin = rng() % table.size();
+    const unsigned int end = begin + rng() % (table.size() - begin + 1);
+
+    auto expected = std::vector<unsigned int>();
+    for (unsigned int i = begin; i < end; i++)
+    {
+      if (table[i].keymask.intersect(km))
+      {
+        expected.push_back(i);
+      }
+    }
+
+    auto found = std::vector<unsigned int>();
+    unsigned int tests = 0;
+    Intersect::for_each(table, begin, end, km,
+                        [&found] (unsigned int i) { found.push_back(i); },
+                        tests);
+    EXPECT_EQ(found, expected);
+    EXPECT_EQ(tests, end - begin);
+
+    // A scan tests every entry of each block up to the one holding the hit
+    const unsigned int first = expected.empty() ? end : expected.front();
+    tests = 0;
+    EXPECT_EQ(Intersect::find_first(table, begin, end, km, tests), first);
+    const unsigned int blocks = (first - begin) / Intersect::BLOCK + 1;
+    EXPECT_EQ(tests, std::min(end - begin, blocks * Intersect::BLOCK));
+  }
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "keymask_trie.h"
+
+using RoutingTable::KeyMask;
+using RoutingTable::KeyMaskTrie;
+
+
+class KeyMaskTrieTest : public ::testing::Test
+{
+};
+
+
+TEST(KeyMaskTrieTest, test_empty)
+{
+  KeyMaskTrie trie;
+  EXPECT_EQ(trie.size(), 0u);
+  EXPECT_FALSE(trie.any_intersecting({0x0, 0x0}));
+}
+
+
+TEST(KeyMaskTrieTest, test_intersecting)
+{
+  KeyMaskTrie trie;
+  trie.insert({0b0000, 0b1111}, 0);
+  trie.insert({0b0100, 0b1100}, 1);  // 01XX
+  trie.insert({0b1000, 0b1000}, 2);  // 1XXX
+
+  EXPECT_TRUE(trie.any_intersecting({0b0000, 0b1111}));
+  EXPECT_TRUE(trie.any_intersecting({0b0110, 0b1111}));
+  EXPECT_FALSE(trie.any_intersecting({0b0010, 0b1111}));
+  EXPECT_FALSE(trie.any_intersecting({0b0010, 0b1110}));
+
+  auto values = std::vector<unsigned int>();
+  trie.for_each_intersecting({0b0000, 0b0000}, [&] (KeyMask, unsigned int v) {
+    values.push_back(v);
+    return true;
+  });
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values, std::vector<unsigned int>({0, 1, 2}));
+
+  // Iteration stops once the callback returns false
+  unsigned int calls = 0;
+  EXPECT_FALSE(trie.for_each_intersecting({0b0000, 0b0000},
+    [&] (KeyMask, unsigned int) { calls++; return false; }
+  ));
+  EXPECT_EQ(calls, 1u);
+
+  trie.clear();
+  EXPECT_EQ(trie.size(), 0u);
+  EXPECT_FALSE(trie.any_intersecting({0b0000, 0b0000}));
+}
+
+
+TEST(KeyMaskTrieTest, test_matches_linear_scan)
+{
+  // Queries should find exactly those key-masks found by testing every
+  // key-mask, including many copies of the same key-mask and key-masks with
+  // Xs in any bit.
+  std::mt19937 rng(10);
+  for (unsigned int trial = 0; trial < 10; trial++)
+  {
+    auto kms = std::vector<KeyMask>();
+    KeyMaskTrie trie;
+    for (unsigned int i = 0; i < 2000; i++)
+    {
+      const uint32_t mask = rng() | (trial % 2 ? 0xffff0000 : 0xfffffff0);
+      KeyMask km = {(uint32_t) rng() & mask, mask};
+      if (i % 10 == 0)
+      {
+        km = {0x1234 & 0xffffff00, 0xffffff00};
+      }
+      kms.push_back(km);
+      trie.insert(km, i);
+    }
+    EXPECT_EQ(trie.size(), kms.size());
+
+    for (unsigned int q = 0; q < 200; q++)
+    {
+      const uint32_t mask = rng() | rng();
+      const KeyMask query = {(uint32_t) rng() & mask, mask};
+
+      auto expected = std::vector<unsigned int>();
+      for (unsigned int i = 0; i < kms.size(); i++)
+      {
+        if (kms[i].intersect(query))
+        {
+          expected.push_back(i);
+        }
+      }
+
+      auto found = std::vector<unsigned int>();
+      trie.for_each_intersecting(query, [&] (KeyMask km, unsigned int v) {
+        EXPECT_EQ(km, kms[v]);
+        found.push_back(v);
+        return true;
+      });
+      std::sort(found.begin(), found.end());
+      EXPECT_EQ(found, expected);
+      EXPECT_EQ(trie.any_intersecting(query), !expected.empty());
+    }
+  }
+}
+
+
+TEST(KeyMaskTrieTest, test_range_erase_and_update)
+{
+  // Mirror a list of key-masks in a trie while erasing from it and shifting
+  // the values of what remains, checking range-restricted queries throughout.
+  std::mt19937 rng(12);
+  auto kms = std::vector<KeyMask>();
+  KeyMaskTrie trie;
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    const uint32_t mask = rng() | 0xfffff000;
+    kms.push_back({(uint32_t) rng() & mask, mask});
+    trie.insert(kms.back(), i);
+  }
+
+  for (unsigned int round = 0; round < 20; round++)
+  {
+    // Erase some key-masks and renumber the rest to close the gaps
+    auto new_index = std::vector<unsigned int>();
+    auto remaining = std::vector<KeyMask>();
+    for (unsigned int i = 0; i < kms.size(); i++)
+    {
+      new_index.push_back(remaining.size());
+      if (rng() % 10 == 0)
+      {
+        EXPECT_TRUE(trie.erase(kms[i], i));
+        EXPECT_FALSE(trie.erase(kms[i], i));
+      }
+      else
+      {
+        remaining.push_back(kms[i]);
+      }
+    }
+    trie.update_values([&] (unsigned int i) { return new_index[i]; });
+    kms = remaining;
+    EXPECT_EQ(trie.size(), kms.size());
+
+    for (unsigned int q = 0; q < 20; q++)
+    {
+      const uint32_t mask = rng() | 0xffff0000;
+      const KeyMask query = {(uint32_t) rng() & mask, mask};
+      const unsigned int begin = rng() % (kms.size() + 1);
+      const unsigned int end = begin + rng() % (kms.size() + 1 - begin);
+
+      auto expected = std::vector<unsigned int>();
+      for (unsigned int i = begin; i < end; i++)
+      {
+        if (kms[i].intersect(query))
+        {
+          expected.push_back(i);
+        }
+      }
+
+      auto found = std::vector<unsigned int>();
+      trie.for_each_intersecting(query, begin, end,
+        [&] (KeyMask km, unsigned int v) {
+          EXPECT_EQ(km, kms[v]);
+          found.push_back(v);
+          return true;
+        }
+      );
+      std::sort(found.begin(), found.end());
+      EXPECT_EQ(found, expected);
+    }
+  }
+}
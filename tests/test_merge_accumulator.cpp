@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "bit_vector.h"
+#include "merge_accumulator.h"
+#include "routing_table.h"
+
+using OrderedCovering::MergeAccumulator;
+using RoutingTable::Entry;
+
+
+class MergeAccumulatorTest : public ::testing::Test
+{
+};
+
+
+TEST(MergeAccumulatorTest, test_add_and_remove)
+{
+  auto table = RoutingTable::Table(3);
+  table[0] = {{0x0, 0xffffffff}, 1, 1};  // 00000000000000000000000000000000
+  table[1] = {{0x1, 0xffffffff}, 2, 2};  // 00000000000000000000000000000001
+  table[2] = {{0x3, 0xfffffffd}, 4, 1};  // 000000000000000000000000000000X1
+
+  // An empty accumulator gives the same entry as an empty merge
+  MergeAccumulator accumulated;
+  EXPECT_EQ(accumulated.size(), 0u);
+  EXPECT_EQ(accumulated.entry(), Entry({{0x0, 0x0}, 0x0, 0x0}));
+
+  // Merging a single entry gives the entry
+  accumulated.add(table[1]);
+  EXPECT_EQ(accumulated.entry(), table[1]);
+
+  // Wherever bits differ, or any entry has an X, there is an X
+  accumulated.add(table[0]);
+  accumulated.add(table[2]);
+  EXPECT_EQ(accumulated.size(), 3u);
+  EXPECT_EQ(accumulated.entry(), Entry({{0x0, 0xfffffffc}, 0b111, 0b11}));
+
+  // Removing entries removes the Xs they introduced
+  accumulated.remove(table[0]);
+  EXPECT_EQ(accumulated.entry(), Entry({{0x1, 0xfffffffd}, 0b110, 0b11}));
+  accumulated.remove(table[2]);
+  EXPECT_EQ(accumulated.entry(), table[1]);
+
+  // Accumulating a merge of a table
+  auto merge = RoutingTable::BitVector(table.size(), true);
+  merge.reset(1);
+  EXPECT_EQ(MergeAccumulator(table, merge).entry(),
+            Entry({{0x0, 0xfffffffc}, 0b101, 0b1}));
+
+  accumulated.clear();
+  EXPECT_EQ(accumulated.size(), 0u);
+  EXPECT_EQ(accumulated.entry(), Entry({{0x0, 0x0}, 0x0, 0x0}));
+}
+
+
+TEST(MergeAccumulatorTest, test_random_members)
+{
+  // Add and remove random entries, comparing the merged entry against one
+  // computed from scratch.
+  std::mt19937 rng(15);
+  auto table = RoutingTable::Table(64);
+  for (auto& entry : table)
+  {
+    entry.keymask.mask = rng() | rng() | 0xff000000;
+    entry.keymask.key = rng() & entry.keymask.mask;
+    entry.source = rng() & rng();
+    entry.route = rng() & rng();
+  }
+
+  MergeAccumulator accumulated;
+  auto members = std::vector<bool>(table.size(), false);
+  for (unsigned int step = 0; step < 1000; step++)
+  {
+    const unsigned int i = rng() % table.size();
+    if (members[i])
+    {
+      accumulated.remove(table[i]);
+    }
+    else
+    {
+      accumulated.add(table[i]);
+    }
+    members[i] = !members[i];
+
+    unsigned int n = 0;
+    uint32_t all_zeros = 0xffffffff, all_ones = 0xffffffff;
+    uint32_t sources = 0x0, routes = 0x0;
+    for (unsigned int j = 0; j < table.size(); j++)
+    {
+      if (members[j])
+      {
+        const auto& km = table[j].keymask;
+        n++;
+        all_zeros &= ~km.key & km.mask;
+        all_ones &= km.key & km.mask;
+        sources |= table[j].source;
+        routes |= table[j].route;
+      }
+    }
+    const uint32_t mask = n ? all_zeros | all_ones : 0x0;
+    const Entry expected = {{all_ones & mask, mask}, sources, routes};
+
+    ASSERT_EQ(accumulated.size(), n);
+    ASSERT_EQ(accumulated.entry(), expected);
+
+    // Check the per-bit counts
+    for (unsigned int b = 0; b < 32; b++)
+    {
+      unsigned int zeros = 0, ones = 0, xs = 0;
+      for (unsigned int j = 0; j < table.size(); j++)
+      {
+        if (members[j])
+        {
+          const auto& km = table[j].keymask;
+          zeros += (~km.key & km.mask) >> b & 1;
+          ones += km.key >> b & 1;
+          xs += ~km.mask >> b & 1;
+        }
+      }
+      ASSERT_EQ(accumulated.zeros(b), zeros);
+      ASSERT_EQ(accumulated.ones(b), ones);
+      ASSERT_EQ(accumulated.xs(b), xs);
+    }
+  }
+}
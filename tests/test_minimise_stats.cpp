@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "minimise_stats.h"
+
+using namespace OrderedCovering;
+
+
+class MinimiseStatsTest : public ::testing::Test
+{
+};
+
+
+TEST(MinimiseStatsTest, test_count)
+{
+  Stats stats;
+  stats.count(ITERATIONS);
+  stats.count(ITERATIONS);
+  stats.count(INTERSECT_TESTS, 40);
+
+  EXPECT_EQ(stats.get(ITERATIONS), 2u);
+  EXPECT_EQ(stats.get(INTERSECT_TESTS), 40u);
+  EXPECT_EQ(stats.get(CANDIDATES), 0u);
+
+  // Copies are independent of the original
+  Stats copy = stats;
+  stats.count(ITERATIONS);
+  EXPECT_EQ(copy.get(ITERATIONS), 2u);
+  EXPECT_EQ(stats.get(ITERATIONS), 3u);
+}
+
+
+TEST(MinimiseStatsTest, test_count_concurrently)
+{
+  Stats stats;
+  auto threads = std::vector<std::thread>();
+  for (unsigned int t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&stats] () {
+      for (unsigned int i = 0; i < 10000; i++)
+      {
+        stats.count(CANDIDATES);
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(stats.get(CANDIDATES), 40000u);
+}
+
+
+TEST(MinimiseStatsTest, test_time)
+{
+  Stats stats;
+  {
+    auto timer = stats.time(APPLY);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_GE(stats.get(APPLY), 0.005);
+
+  // A stopped timer records nothing more
+  auto timer = stats.time(SELECTION);
+  timer.stop();
+  const double selection = stats.get(SELECTION);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  timer.stop();
+  EXPECT_EQ(stats.get(SELECTION), selection);
+  EXPECT_EQ(stats.get(INDEXING), 0.0);
+}
+
+
+TEST(MinimiseStatsTest, test_to_json)
+{
+  Stats stats;
+  stats.count(ITERATIONS, 3);
+  stats.count(ALIASES_SCANNED, 7);
+
+  const auto json = stats.to_json();
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_EQ(json.back(), '}');
+  EXPECT_NE(json.find("\"iterations\": 3,"), std::string::npos);
+  EXPECT_NE(json.find("\"aliases_scanned\": 7,"), std::string::npos);
+  EXPECT_NE(json.find("\"time_s\": {\"indexing\": 0, "), std::string::npos);
+  EXPECT_EQ(json.find('\n'), std::string::npos);
+}
+
+
+TEST(MinimiseStatsTest, test_holder_is_nothrow_movable)
+{
+  // Objects holding stats are moved, rather than copied, by containers
+  struct Holder
+  {
+    std::vector<int> data;
+    Stats stats;
+  };
+  EXPECT_TRUE(std::is_nothrow_move_constructible<Holder>::value);
+}
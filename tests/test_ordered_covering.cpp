@@ -1,7 +1,49 @@
+#include <stdlib.h>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include "bounded_covering.h"
+#include "default_routes.h"
 #include "ordered_covering.h"
 
 
+// Count the memory allocations made while `counting_allocations` is set, see
+// test_minimise_workspace. The replacements are not inlined so that an
+// optimising compiler does not see new and delete expressions paired with
+// malloc and free and report them as mismatched.
+static std::atomic<bool> counting_allocations(false);
+static std::atomic<unsigned long> allocations(0);
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+  if (counting_allocations.load())
+  {
+    allocations++;
+  }
+
+  void* p = malloc(size ? size : 1);
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+
 class OrderedCoveringTest : public ::testing::Test
 {
 };
@@ -74,6 +116,66 @@ TEST(OrderedCoveringTest, test_get_insertion_index)
 }
 
 
+TEST(OrderedCoveringTest, test_sort_table)
+{
+  // Entries should be stably sorted into increasing generality
+  RoutingTable::Table table = {
+    {{0b0000, 0b0000}, 0x0, 0x1},  // XXXX
+    {{0b0001, 0b1111}, 0x0, 0x2},  // 0001
+    {{0b0100, 0b1100}, 0x0, 0x3},  // 01XX
+    {{0b0000, 0b1111}, 0x0, 0x4},  // 0000
+    {{0b1000, 0b1100}, 0x0, 0x5},  // 10XX
+  };
+  OrderedCovering::sort_table(table);
+
+  ASSERT_EQ(table.size(), 5);
+  EXPECT_EQ(table[0].route, 0x2);
+  EXPECT_EQ(table[1].route, 0x4);
+  EXPECT_EQ(table[2].route, 0x3);
+  EXPECT_EQ(table[3].route, 0x5);
+  EXPECT_EQ(table[4].route, 0x1);
+}
+
+
+TEST(OrderedCoveringTest, test_get_insertion_index_with_index)
+{
+  using OrderedCovering::get_insertion_index;
+
+  // The indexed form should agree with the search for every generality
+  RoutingTable::Table table = {
+    {{0b00, 0b11}, 0x0, 0x0},  // ...00
+    {{0b00, 0b01}, 0x0, 0x0},  // ...X0
+    {{0b01, 0b01}, 0x0, 0x0},  // ...X1
+    {{0b00, 0b10}, 0x0, 0x0},  // ...0X
+    {{0x0, 0x0}, 0x0, 0x0},    // XXXX
+  };
+  auto index = OrderedCovering::get_generality_index(table);
+  EXPECT_EQ(index.offsets[0], 0);
+  EXPECT_EQ(index.offsets[30], 0);
+  EXPECT_EQ(index.offsets[31], 1);
+  EXPECT_EQ(index.offsets[32], 4);
+  EXPECT_EQ(index.offsets[33], 5);
+
+  for (unsigned int g = 0; g <= 32; g++)
+  {
+    EXPECT_TRUE(get_insertion_index(table, index, g) ==
+                get_insertion_index(table, g));
+  }
+
+  // Applying a merge should keep the index up to date: merging the X0 and X1
+  // entries produces an entry of generality 32 (...XX).
+  auto aliases = OrderedCovering::AliasTable();
+  OrderedCovering::Merge merge = {false, true, true, false, false};
+  OrderedCovering::merge_apply(table, index, aliases, merge);
+
+  auto expected = OrderedCovering::get_generality_index(table);
+  for (unsigned int g = 0; g < 34; g++)
+  {
+    EXPECT_EQ(index.offsets[g], expected.offsets[g]);
+  }
+}
+
+
 TEST(OrderedCoveringTest, test_refine_merge_upcheck)
 {
   // Test that entries which would be covered by being moved below entries are
@@ -703,3 +805,734 @@ TEST(OrderedCoveringTest, test_ordered_covering_terminates_early)
   EXPECT_LT(table.size(), 8);
   EXPECT_GT(table.size(), 4);
 }
+
+
+TEST(OrderedCoveringTest, test_get_route_index)
+{
+  // Entries should be grouped by route in table order
+  RoutingTable::Table table = {
+    {{0x0, 0xf}, 0x0, 0b001},
+    {{0x1, 0xf}, 0x0, 0b010},
+    {{0x2, 0xf}, 0x0, 0b001},
+    {{0x3, 0xf}, 0x0, 0b100},
+    {{0x4, 0xf}, 0x0, 0b001},
+  };
+
+  auto routes = OrderedCovering::get_route_index(table);
+  ASSERT_EQ(routes.size(), 3);
+  EXPECT_EQ(routes[0b001], std::vector<unsigned int>({0, 2, 4}));
+  EXPECT_EQ(routes[0b010], std::vector<unsigned int>({1}));
+  EXPECT_EQ(routes[0b100], std::vector<unsigned int>({3}));
+}
+
+
+TEST(OrderedCoveringTest, test_merge_apply_updates_route_index)
+{
+  // Merge the entries routed N, the merged entry will be inserted between the
+  // last generality 0 entry and the final entry:
+  //
+  //   0000 -> N
+  //   0001 -> E
+  //   0010 -> N
+  //   0100 -> E
+  //   1XXX -> S
+  //
+  // The result should be:
+  //
+  //   0001 -> E
+  //   0100 -> E
+  //   00X0 -> N
+  //   1XXX -> S
+  RoutingTable::Table table = {
+    {{0x0, 0xf}, 0x0, 0b000100},
+    {{0x1, 0xf}, 0x0, 0b000001},
+    {{0x2, 0xf}, 0x0, 0b000100},
+    {{0x4, 0xf}, 0x0, 0b000001},
+    {{0x8, 0x8}, 0x0, 0b100000},
+  };
+  auto aliases = OrderedCovering::AliasTable();
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto routes = OrderedCovering::get_route_index(table);
+  OrderedCovering::Merge merge = {true, false, true, false, false};
+
+  OrderedCovering::merge_apply(table, generality, aliases, merge, routes);
+
+  // The route index should match one built from the new table
+  ASSERT_EQ(table.size(), 4);
+  EXPECT_EQ(table[2].keymask.mask, 0xd);
+  EXPECT_EQ(routes, OrderedCovering::get_route_index(table));
+  EXPECT_EQ(routes[0b000100], std::vector<unsigned int>({2}));
+  EXPECT_EQ(routes[0b000001], std::vector<unsigned int>({0, 1}));
+  EXPECT_EQ(routes[0b100000], std::vector<unsigned int>({3}));
+}
+
+
+TEST(OrderedCoveringTest, test_get_best_merge_with_cache)
+{
+  // The cached form of get_best_merge should select the same merge as the
+  // uncached form and record the refinement of every group it refines.
+  //
+  //   00000000 -> E
+  //   00010000 -> E
+  //   00100000 -> E
+  //   10000000 -> E
+  //   11110000 -> E
+  //   01000000 -> S
+  //   01010000 -> S
+  //   1XXXXXXX -> N
+  RoutingTable::Table table = {
+    {{0x00, 0xff}, 0b010, 0b001},
+    {{0x10, 0xff}, 0b010, 0b001},
+    {{0x20, 0xff}, 0b010, 0b001},
+    {{0x80, 0xff}, 0b010, 0b001},
+    {{0xf0, 0xff}, 0b010, 0b001},
+    {{0x40, 0xff}, 0b010, 0b100000},
+    {{0x50, 0xff}, 0b010, 0b100000},
+    {{0x80, 0x80}, 0b110, 0b100},
+  };
+  auto aliases = OrderedCovering::AliasTable();
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto routes = OrderedCovering::get_route_index(table);
+  auto cache = OrderedCovering::MergeCache();
+
+  auto merge = OrderedCovering::get_best_merge(table, generality, aliases,
+                                               routes, cache);
+  EXPECT_EQ(merge, OrderedCovering::get_best_merge(table, aliases));
+  EXPECT_EQ(merge, OrderedCovering::Merge(
+    {true, true, true, false, false, false, false, false}));
+
+  ASSERT_EQ(cache.size(), 3);
+  EXPECT_TRUE(cache[0b001].valid);
+  EXPECT_EQ(cache[0b001].goodness, 2);
+  EXPECT_EQ(cache[0b001].members, std::vector<unsigned int>({0, 1, 2}));
+
+  // The other groups could not beat the E group so were never refined
+  EXPECT_FALSE(cache[0b100000].valid);
+  EXPECT_FALSE(cache[0b100].valid);
+
+  auto scratch = OrderedCovering::Merge(table.size(), false);
+  OrderedCovering::refine_cached_merge(table, generality, aliases,
+                                       routes.at(0b100000), cache[0b100000],
+                                       scratch);
+  OrderedCovering::refine_cached_merge(table, generality, aliases,
+                                       routes.at(0b100), cache[0b100],
+                                       scratch);
+  EXPECT_TRUE(cache[0b100000].valid);
+  EXPECT_EQ(cache[0b100000].goodness, 1);
+  EXPECT_TRUE(cache[0b100].valid);
+  EXPECT_EQ(cache[0b100].goodness, 0);
+
+  // Merging the E entries produces 00XX0000 which intersects neither the
+  // group of S entries (010X0000) nor the N entry, only the E group must be
+  // refined again.
+  auto merge_entry = OrderedCovering::merge_entries(table, merge);
+  OrderedCovering::merge_apply(table, generality, aliases, merge, routes);
+  OrderedCovering::merge_cache_invalidate(cache, merge_entry);
+
+  EXPECT_FALSE(cache[0b001].valid);
+  EXPECT_TRUE(cache[0b100000].valid);
+  EXPECT_TRUE(cache[0b100].valid);
+
+  // Subsequent merges should still match the uncached form
+  merge = OrderedCovering::get_best_merge(table, generality, aliases, routes,
+                                          cache);
+  EXPECT_EQ(merge, OrderedCovering::get_best_merge(table, aliases));
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_soa_table)
+{
+  // Minimising a structure-of-arrays table should produce the same table and
+  // aliases as minimising the equivalent array-of-structures table.
+  std::mt19937 rng(4);
+  for (unsigned int trial = 0; trial < 20; trial++)
+  {
+    auto table = RoutingTable::Table(50 + trial * 10);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 1 << (rng() % 6);
+      entry.route = 1 << (rng() % 8);
+    }
+    OrderedCovering::sort_table(table);
+
+    auto soa = RoutingTable::SoATable(table);
+    auto soa_sorted = soa;
+    OrderedCovering::sort_table(soa_sorted);
+    EXPECT_EQ(soa_sorted.to_table(), table);
+
+    auto table_aliases = OrderedCovering::Aliases();
+    auto soa_aliases = OrderedCovering::Aliases();
+    OrderedCovering::minimise(table, 0, table_aliases);
+    OrderedCovering::minimise(soa, 0, soa_aliases);
+
+    EXPECT_EQ(soa.to_table(), table);
+    EXPECT_EQ(soa_aliases, table_aliases);
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_get_best_merge_lazy)
+{
+  // Candidates are evaluated largest first, so once the large group has been
+  // refined none of the small groups could beat it and none are refined. The
+  // parallel form must refine exactly the same candidates.
+  //
+  //   0000000XXXXX -> E (16 entries, which merge without conflict)
+  //   0001000X000X -> route 1 << (g + 1) (pairs for g = 0, 1, ... 9)
+  auto table = RoutingTable::Table();
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    table.push_back({{i, 0xfff}, 0x0, 0b1});
+  }
+  for (uint32_t g = 0; g < 10; g++)
+  {
+    table.push_back({{0x100 + 2*g, 0xfff}, 0x0, 1u << (g + 1)});
+    table.push_back({{0x101 + 2*g, 0xfff}, 0x0, 1u << (g + 1)});
+  }
+
+  auto aliases = OrderedCovering::AliasTable();
+  auto generality = OrderedCovering::get_generality_index(table);
+  auto routes = OrderedCovering::get_route_index(table);
+  auto expected = OrderedCovering::Merge(table.size(), false);
+  for (unsigned int i = 0; i < 16; i++)
+  {
+    expected.set(i);
+  }
+  EXPECT_EQ(OrderedCovering::get_best_merge(table, aliases), expected);
+
+  auto cache = OrderedCovering::MergeCache();
+  OrderedCovering::Stats stats;
+  EXPECT_EQ(OrderedCovering::get_best_merge(table, generality, aliases, routes,
+                                            cache, stats), expected);
+  EXPECT_EQ(stats.get(OrderedCovering::CANDIDATES), 1u);
+  EXPECT_TRUE(cache[0b1].valid);
+  EXPECT_FALSE(cache[0b10].valid);
+
+  Parallel::WorkStealingPool pool(4);
+  auto parallel_cache = OrderedCovering::MergeCache();
+  OrderedCovering::Stats parallel_stats;
+  EXPECT_EQ(OrderedCovering::get_best_merge(table, generality, aliases, routes,
+                                            parallel_cache, pool,
+                                            parallel_stats), expected);
+  EXPECT_EQ(parallel_stats.get(OrderedCovering::CANDIDATES), 1u);
+  EXPECT_FALSE(parallel_cache[0b10].valid);
+}
+
+
+TEST(OrderedCoveringTest, test_get_best_merge_parallel)
+{
+  // Refining the groups concurrently should choose the same merge as the
+  // serial forms, including when several groups tie for the best goodness.
+  std::mt19937 rng(6);
+  Parallel::WorkStealingPool pool(4);
+  for (unsigned int trial = 0; trial < 50; trial++)
+  {
+    auto table = RoutingTable::Table(20 + trial * 4);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xffffff00;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % (2 + trial % 8));
+    }
+    OrderedCovering::sort_table(table);
+
+    auto aliases = OrderedCovering::AliasTable();
+    auto generality = OrderedCovering::get_generality_index(table);
+    auto routes = OrderedCovering::get_route_index(table);
+    auto serial = OrderedCovering::get_best_merge(table, generality, aliases,
+                                                  routes);
+    EXPECT_EQ(OrderedCovering::get_best_merge(table, generality, aliases,
+                                              routes, pool), serial);
+
+    auto cache = OrderedCovering::MergeCache();
+    EXPECT_EQ(OrderedCovering::get_best_merge(table, generality, aliases,
+                                              routes, cache, pool), serial);
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_parallel)
+{
+  std::mt19937 rng(7);
+  Parallel::WorkStealingPool pool(3);
+  for (unsigned int trial = 0; trial < 10; trial++)
+  {
+    auto table = RoutingTable::Table(200);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % 8);
+    }
+    OrderedCovering::sort_table(table);
+
+    auto expected = table;
+    auto expected_aliases = OrderedCovering::AliasTable();
+    OrderedCovering::minimise(expected, 0, expected_aliases);
+
+    auto aliases = OrderedCovering::AliasTable();
+    OrderedCovering::minimise(table, 0, aliases, pool);
+    EXPECT_EQ(table, expected);
+    EXPECT_EQ(aliases.to_aliases(), expected_aliases.to_aliases());
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_stats)
+{
+  // Collecting statistics should not change the result. The cached forms of
+  // get_best_merge refine the same groups whether or not they run in
+  // parallel, so the counts should also be the same.
+  std::mt19937 rng(8);
+  Parallel::WorkStealingPool pool(3);
+  for (unsigned int trial = 0; trial < 10; trial++)
+  {
+    auto table = RoutingTable::Table(200);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % 8);
+    }
+    OrderedCovering::sort_table(table);
+
+    auto expected = table;
+    auto expected_aliases = OrderedCovering::AliasTable();
+    OrderedCovering::minimise(expected, 0, expected_aliases);
+
+    auto serial = table;
+    auto serial_aliases = OrderedCovering::AliasTable();
+    OrderedCovering::Stats serial_stats;
+    OrderedCovering::minimise(serial, 0, serial_aliases, serial_stats);
+    EXPECT_EQ(serial, expected);
+
+    auto parallel = table;
+    auto parallel_aliases = OrderedCovering::AliasTable();
+    OrderedCovering::Stats parallel_stats;
+    OrderedCovering::minimise(parallel, 0, parallel_aliases, pool,
+                              parallel_stats);
+    EXPECT_EQ(parallel, expected);
+
+    // Every merge removes at least one entry
+    const auto iterations = serial_stats.get(OrderedCovering::ITERATIONS);
+    EXPECT_GT(iterations, 0u);
+    EXPECT_LE(iterations, table.size() - serial.size());
+    EXPECT_GE(serial_stats.get(OrderedCovering::CANDIDATES), iterations);
+    EXPECT_GT(serial_stats.get(OrderedCovering::INTERSECT_TESTS), 0u);
+
+    for (unsigned int c = 0; c < OrderedCovering::N_COUNTERS; c++)
+    {
+      EXPECT_EQ(parallel_stats.get((OrderedCovering::Counter) c),
+                serial_stats.get((OrderedCovering::Counter) c));
+    }
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_with_limits)
+{
+  // Stopping at a limit should leave the table part way through the same
+  // sequence of merges, so that resuming minimisation with the same aliases
+  // gives the same table as minimising without limits.
+  std::mt19937 rng(9);
+  Parallel::WorkStealingPool pool(2);
+  for (unsigned int trial = 0; trial < 10; trial++)
+  {
+    auto table = RoutingTable::Table(200);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % 8);
+    }
+    OrderedCovering::sort_table(table);
+
+    auto expected = table;
+    auto expected_aliases = OrderedCovering::AliasTable();
+    auto limits = OrderedCovering::Limits();
+    EXPECT_EQ(OrderedCovering::minimise(expected, 0, expected_aliases, limits),
+              OrderedCovering::NO_MERGES);
+
+    auto limited = table;
+    auto aliases = OrderedCovering::AliasTable();
+    OrderedCovering::Stats stats;
+    limits.max_iterations = 3;
+    EXPECT_EQ(OrderedCovering::minimise(limited, 0, aliases, limits, stats),
+              OrderedCovering::OUT_OF_ITERATIONS);
+    EXPECT_EQ(stats.get(OrderedCovering::ITERATIONS), 3u);
+    EXPECT_LT(limited.size(), table.size());
+
+    EXPECT_EQ(OrderedCovering::minimise(limited, 0, aliases, pool,
+                                        OrderedCovering::Limits()),
+              OrderedCovering::NO_MERGES);
+    EXPECT_EQ(limited, expected);
+    EXPECT_EQ(aliases.to_aliases(), expected_aliases.to_aliases());
+
+    // A table which reaches the target says so
+    limited = table;
+    aliases = OrderedCovering::AliasTable();
+    EXPECT_EQ(OrderedCovering::minimise(limited, table.size() - 1, aliases,
+                                        OrderedCovering::Limits()),
+              OrderedCovering::TARGET_MET);
+    EXPECT_LT(limited.size(), table.size());
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_deadline_and_cancellation)
+{
+  // A passed deadline or a set cancellation token should leave the table
+  // untouched.
+  auto table = RoutingTable::Table({
+    {{0b0000, 0b1111}, 0b0, 0b1},
+    {{0b0001, 0b1111}, 0b0, 0b1},
+    {{0b0010, 0b1111}, 0b0, 0b1},
+  });
+  const auto original = table;
+
+  auto aliases = OrderedCovering::AliasTable();
+  auto limits = OrderedCovering::Limits();
+  limits.deadline = std::chrono::steady_clock::now();
+  EXPECT_EQ(OrderedCovering::minimise(table, 0, aliases, limits),
+            OrderedCovering::TIMED_OUT);
+  EXPECT_EQ(table, original);
+
+  std::atomic<bool> cancel(true);
+  limits = OrderedCovering::Limits();
+  limits.cancel = &cancel;
+  EXPECT_EQ(OrderedCovering::minimise(table, 0, aliases, limits),
+            OrderedCovering::CANCELLED);
+  EXPECT_EQ(table, original);
+
+  cancel = false;
+  EXPECT_EQ(OrderedCovering::minimise(table, 0, aliases, limits),
+            OrderedCovering::NO_MERGES);
+  EXPECT_LT(table.size(), original.size());
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_indexed_table)
+{
+  // Minimising a table indexed by key-mask should give the same table and
+  // aliases as minimising the table alone, with the index kept up to date.
+  std::mt19937 rng(14);
+  auto table = RoutingTable::Table(3000);
+  for (auto& entry : table)
+  {
+    entry.keymask.mask = rng() | 0xffffe000;
+    entry.keymask.key = rng() & entry.keymask.mask;
+    entry.source = 0x0;
+    entry.route = 1 << (rng() % 16);
+  }
+  OrderedCovering::sort_table(table);
+
+  auto expected = table;
+  auto expected_aliases = OrderedCovering::AliasTable();
+  OrderedCovering::minimise_with(expected, 0, expected_aliases,
+    OrderedCovering::Limits(),
+    [&] (const OrderedCovering::GeneralityIndex& generality,
+         const OrderedCovering::RouteIndex& routes,
+         OrderedCovering::MergeCache& cache)
+    {
+      return OrderedCovering::get_best_merge(expected, generality,
+                                             expected_aliases, routes, cache);
+    }
+  );
+
+  auto indexed = RoutingTable::IndexedTable<RoutingTable::Table>(table);
+  auto aliases = OrderedCovering::AliasTable();
+  OrderedCovering::minimise_with(indexed, 0, aliases,
+    OrderedCovering::Limits(),
+    [&] (const OrderedCovering::GeneralityIndex& generality,
+         const OrderedCovering::RouteIndex& routes,
+         OrderedCovering::MergeCache& cache)
+    {
+      return OrderedCovering::get_best_merge(indexed, generality, aliases,
+                                             routes, cache);
+    }
+  );
+
+  EXPECT_LT(table.size(), 3000u);
+  EXPECT_EQ(table, expected);
+  EXPECT_EQ(aliases.to_aliases(), expected_aliases.to_aliases());
+
+  auto reindexed = RoutingTable::IndexedTable<RoutingTable::Table>(table);
+  for (unsigned int i = 0; i < table.size(); i++)
+  {
+    auto values = std::vector<unsigned int>();
+    indexed.keymasks().for_each_intersecting(table[i].keymask,
+      [&] (RoutingTable::KeyMask, unsigned int v) {
+        values.push_back(v);
+        return true;
+      }
+    );
+    auto reindexed_values = std::vector<unsigned int>();
+    reindexed.keymasks().for_each_intersecting(table[i].keymask,
+      [&] (RoutingTable::KeyMask, unsigned int v) {
+        reindexed_values.push_back(v);
+        return true;
+      }
+    );
+    std::sort(values.begin(), values.end());
+    std::sort(reindexed_values.begin(), reindexed_values.end());
+    EXPECT_EQ(values, reindexed_values);
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_workspace)
+{
+  // Minimising tables with a workspace should give the same results as
+  // minimising them without, and once the workspace has been used for the
+  // tables minimising them again should allocate no memory. The longest table
+  // is indexed by key-mask while it is minimised.
+  std::mt19937 rng(16);
+  auto tables = std::vector<RoutingTable::Table>();
+  for (unsigned int length : {300u, 1000u, 600u,
+                              OrderedCovering::KEYMASK_INDEX_LENGTH})
+  {
+    auto table = RoutingTable::Table(length);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1u << (rng() % std::min(length / 100, 32u));
+    }
+    OrderedCovering::sort_table(table);
+    tables.push_back(table);
+  }
+
+  auto workspace = OrderedCovering::Workspace();
+  auto aliases = OrderedCovering::AliasTable();
+  for (unsigned int round = 0; round < 2; round++)
+  {
+    for (const auto& table : tables)
+    {
+      auto expected = table;
+      auto expected_aliases = OrderedCovering::AliasTable();
+      OrderedCovering::minimise(expected, 0, expected_aliases);
+
+      auto minimised = table;
+      aliases.clear();
+      allocations = 0;
+      counting_allocations = true;
+      EXPECT_EQ(OrderedCovering::minimise(minimised, 0, aliases, workspace),
+                OrderedCovering::NO_MERGES);
+      counting_allocations = false;
+
+      EXPECT_EQ(minimised, expected);
+      EXPECT_EQ(aliases.to_aliases(), expected_aliases.to_aliases());
+      if (round > 0)
+      {
+        EXPECT_EQ(allocations.load(), 0u) << table.size() << " entries";
+      }
+    }
+  }
+}
+
+
+// Get the route of the first entry matching a key, or 0 if none does
+static uint32_t lookup_route(const RoutingTable::Table& table, uint32_t key)
+{
+  for (const auto& entry : table)
+  {
+    if ((key & entry.keymask.mask) == entry.keymask.key)
+    {
+      return entry.route;
+    }
+  }
+  return 0;
+}
+
+
+// Get random tables to minimise, sorted in increasing generality
+static std::vector<RoutingTable::Table> get_random_tables(
+  std::mt19937& rng, std::initializer_list<unsigned int> lengths)
+{
+  auto tables = std::vector<RoutingTable::Table>();
+  for (unsigned int length : lengths)
+  {
+    auto table = RoutingTable::Table(length);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = rng() | 0xfffff000;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % (length / 100));
+    }
+    OrderedCovering::sort_table(table);
+    tables.push_back(table);
+  }
+  return tables;
+}
+
+
+TEST(OrderedCoveringTest, test_bounded_minimise)
+{
+  // Minimising within an arena should give the same tables as minimising
+  // without, allocating no memory and releasing the arena afterwards.
+  std::mt19937 rng(25);
+  auto arena = std::unique_ptr<RoutingTable::FixedArena<1 << 16>>(
+    new RoutingTable::FixedArena<1 << 16>());
+  for (const auto& table : get_random_tables(rng, {300, 1000, 600}))
+  {
+    for (unsigned int target : {0u, (unsigned int) table.size() / 2})
+    {
+      auto expected = table;
+      auto expected_aliases = OrderedCovering::AliasTable();
+      const auto expected_status = OrderedCovering::minimise(
+        expected, target, expected_aliases, OrderedCovering::Limits());
+
+      auto minimised = table;
+      allocations = 0;
+      counting_allocations = true;
+      const auto status = BoundedCovering::minimise(minimised, target,
+                                                    *arena);
+      counting_allocations = false;
+
+      EXPECT_EQ(status, expected_status);
+      EXPECT_EQ(minimised, expected);
+      EXPECT_EQ(allocations.load(), 0u);
+      EXPECT_EQ(arena->used(), 0u);
+      EXPECT_GT(arena->high_water(), 0u);
+      EXPECT_LE(arena->high_water(), arena->capacity());
+    }
+  }
+
+  // SoA tables, and tables held in the arena, should be minimised
+  // identically.
+  auto table = get_random_tables(rng, {500})[0];
+  auto soa = RoutingTable::SoATable(table);
+  auto storage = std::unique_ptr<RoutingTable::FixedArena<1 << 14>>(
+    new RoutingTable::FixedArena<1 << 14>());
+  RoutingTable::ArenaTable in_arena;
+  ASSERT_TRUE(in_arena.allocate(*storage, table.size()));
+  in_arena.resize(table.size());
+  std::copy(table.begin(), table.end(), in_arena.begin());
+
+  OrderedCovering::minimise(table, 0);
+  EXPECT_EQ(BoundedCovering::minimise(soa, 0, *arena),
+            OrderedCovering::NO_MERGES);
+  EXPECT_EQ(soa.to_table(), table);
+  EXPECT_EQ(BoundedCovering::minimise(in_arena, 0, *arena),
+            OrderedCovering::NO_MERGES);
+  EXPECT_EQ(RoutingTable::Table(in_arena.begin(), in_arena.end()), table);
+}
+
+
+TEST(OrderedCoveringTest, test_bounded_alias_table)
+{
+  // Aliases held in an arena should be replaced as in an AliasTable
+  RoutingTable::FixedArena<1024> arena;
+  BoundedCovering::ArenaAliasTable aliases;
+  auto expected = OrderedCovering::AliasTable();
+  ASSERT_TRUE(aliases.allocate(arena));
+  ASSERT_TRUE(aliases.reserve(8));
+
+  const auto a = RoutingTable::KeyMask{0x0, 0xf};
+  const auto b = RoutingTable::KeyMask{0x1, 0xf};
+  const auto c = RoutingTable::KeyMask{0x0, 0xe};
+  const auto d = RoutingTable::KeyMask{0x0, 0xc};
+  const auto e = RoutingTable::KeyMask{0x8, 0x8};
+  const std::pair<RoutingTable::KeyMask, RoutingTable::KeyMask> replaces[] = {
+    {c, a}, {c, b}, {e, e}, {d, c}, {d, d}, {a, e}, {a, a},
+  };
+  for (const auto& replace : replaces)
+  {
+    aliases.replace(replace.first, replace.second);
+    expected.replace(replace.first, replace.second);
+
+    for (const auto& km : {a, b, c, d, e})
+    {
+      const auto range = aliases.lookup(km);
+      auto found = std::set<RoutingTable::KeyMask>();
+      for (auto alias : range)
+      {
+        found.insert(alias);
+      }
+      const auto expected_range = expected.lookup(km);
+      EXPECT_EQ(range.size(), expected_range.size());
+      EXPECT_EQ(found, std::set<RoutingTable::KeyMask>(
+        expected_range.begin(), expected_range.end()));
+    }
+  }
+  EXPECT_EQ(aliases.size(), 3u);
+
+  // There is no room beyond the arena
+  EXPECT_FALSE(aliases.reserve(1024));
+}
+
+
+TEST(OrderedCoveringTest, test_bounded_minimise_out_of_memory)
+{
+  // If there is not enough memory to start the table should be unchanged, if
+  // memory runs out part way through the table should be partly minimised
+  // but should still route every packet as before.
+  std::mt19937 rng(26);
+  const auto table = get_random_tables(rng, {1000})[0];
+
+  RoutingTable::FixedArena<1024> small;
+  auto unchanged = table;
+  EXPECT_EQ(BoundedCovering::minimise(unchanged, 0, small),
+            OrderedCovering::OUT_OF_MEMORY);
+  EXPECT_EQ(unchanged, table);
+  EXPECT_EQ(small.used(), 0u);
+
+  auto full = table;
+  OrderedCovering::minimise(full, 0);
+
+  auto arena = std::unique_ptr<RoutingTable::FixedArena<27 * 1024>>(
+    new RoutingTable::FixedArena<27 * 1024>());
+  auto partial = table;
+  EXPECT_EQ(BoundedCovering::minimise(partial, 0, *arena),
+            OrderedCovering::OUT_OF_MEMORY);
+  EXPECT_LT(partial.size(), table.size());
+  EXPECT_GT(partial.size(), full.size());
+
+  for (const auto& entry : table)
+  {
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      const uint32_t key = entry.keymask.key | (rng() & ~entry.keymask.mask);
+      EXPECT_EQ(lookup_route(partial, key), lookup_route(table, key));
+    }
+  }
+}
+
+
+TEST(OrderedCoveringTest, test_minimise_then_remove_default_routes)
+{
+  // Default routes may only be removed once a table has been minimised: the
+  // merge of the first and last entries covers the key of the pass-through
+  // entry, so had that entry been removed first, key 0x1 arriving on link 0x1
+  // would have been routed to core 0x40 rather than to the opposite link.
+  const auto table = RoutingTable::Table({
+    {{0x0, 0xffffffff}, 0x0, 0x40},
+    {{0x1, 0xffffffff}, 0x1, 0x8},
+    {{0x3, 0xffffffff}, 0x0, 0x40},
+  });
+
+  // Route a packet arriving on a link, as a router would, sending it out of
+  // the opposite link if no entry matches.
+  auto route = [] (const RoutingTable::Table& t, uint32_t key)
+  {
+    const uint32_t matched = lookup_route(t, key);
+    return matched ? matched : 0x8;
+  };
+
+  auto minimised = table;
+  OrderedCovering::minimise(minimised, 0);
+  DefaultRoutes::minimise(minimised);
+  EXPECT_EQ(minimised.size(), 2u);
+  for (uint32_t key : {0x0, 0x1, 0x3})
+  {
+    EXPECT_EQ(route(minimised, key), route(table, key)) << key;
+  }
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "reductions.h"
+
+
+class ReductionsTest : public ::testing::Test
+{
+};
+
+
+// Get the route of the first entry of a table matching a key, or 0 if none do
+static uint32_t route_key(const RoutingTable::Table& table, uint32_t key)
+{
+  for (const auto& entry : table)
+  {
+    if ((key & entry.keymask.mask) == entry.keymask.key)
+    {
+      return entry.route;
+    }
+  }
+  return 0;
+}
+
+
+TEST(ReductionsTest, test_covers)
+{
+  using Reductions::covers;
+  EXPECT_TRUE(covers({0x0, 0xe}, {0x1, 0xf}));   // 000X covers 0001
+  EXPECT_TRUE(covers({0x1, 0xf}, {0x1, 0xf}));   // 0001 covers itself
+  EXPECT_FALSE(covers({0x1, 0xf}, {0x0, 0xe}));  // 0001 does not cover 000X
+  EXPECT_FALSE(covers({0x2, 0xe}, {0x1, 0xf}));  // 001X does not cover 0001
+  EXPECT_FALSE(covers({0x1, 0xe}, {0x1, 0xf}));  // Matches nothing
+}
+
+
+TEST(ReductionsTest, test_remove_duplicates_and_shadowed)
+{
+  RoutingTable::Table table = {
+    {{0x0, 0xe}, 0x0, 0b1},   // 000X -> 1
+    {{0x4, 0xf}, 0x0, 0b10},  // 0100 -> 2
+    {{0x1, 0xf}, 0x0, 0b10},  // 0001 -> 2 (shadowed by 000X)
+    {{0x4, 0xf}, 0x0, 0b1},   // 0100 -> 1 (duplicate of 0100)
+    {{0x4, 0xc}, 0x0, 0b1},   // 01XX -> 1
+    {{0x6, 0xe}, 0x0, 0b1},   // 011X -> 1 (shadowed by 01XX)
+  };
+
+  auto deduplicated = table;
+  Reductions::remove_duplicates(deduplicated);
+  EXPECT_EQ(deduplicated, RoutingTable::Table({
+    table[0], table[1], table[2], table[4], table[5]
+  }));
+
+  auto unshadowed = table;
+  Reductions::remove_shadowed(unshadowed);
+  EXPECT_EQ(unshadowed, RoutingTable::Table({table[0], table[1], table[4]}));
+}
+
+
+TEST(ReductionsTest, test_reductions_random)
+{
+  // Every key should be routed as it was before the reductions, and the same
+  // entries should be removed from a SoATable.
+  std::mt19937 rng(19);
+  for (unsigned int trial = 0; trial < 20; trial++)
+  {
+    auto table = RoutingTable::Table(300);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = (rng() | rng()) & 0x3ff;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % 4);
+    }
+
+    auto deduplicated = table;
+    Reductions::remove_duplicates(deduplicated);
+    auto unshadowed = table;
+    Reductions::remove_shadowed(unshadowed);
+    EXPECT_LE(unshadowed.size(), deduplicated.size());
+    EXPECT_LT(unshadowed.size(), table.size());
+
+    for (uint32_t key = 0; key < 1024; key++)
+    {
+      ASSERT_EQ(route_key(deduplicated, key), route_key(table, key));
+      ASSERT_EQ(route_key(unshadowed, key), route_key(table, key));
+    }
+
+    // No remaining entry is covered by a higher one
+    for (unsigned int i = 0; i < unshadowed.size(); i++)
+    {
+      for (unsigned int j = 0; j < i; j++)
+      {
+        ASSERT_FALSE(Reductions::covers(unshadowed[j].keymask,
+                                        unshadowed[i].keymask));
+      }
+    }
+
+    auto soa = RoutingTable::SoATable(table);
+    Reductions::remove_shadowed(soa);
+    EXPECT_EQ(soa.to_table(), unshadowed);
+  }
+}
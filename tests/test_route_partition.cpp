@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "route_partition.h"
+
+
+class RoutePartitionTest : public ::testing::Test
+{
+};
+
+
+// Get the route of the first entry of a table matching a key, or 0 if none do
+static uint32_t route_key(const RoutingTable::Table& table, uint32_t key)
+{
+  for (const auto& entry : table)
+  {
+    if ((key & entry.keymask.mask) == entry.keymask.key)
+    {
+      return entry.route;
+    }
+  }
+  return 0;
+}
+
+
+TEST(RoutePartitionTest, test_minimise_block)
+{
+  // A complete block of key-masks with the same route becomes one entry,
+  // entries with other routes are left alone.
+  RoutingTable::Table table = {
+    {{0x0, 0xf}, 0b01, 0b1},   // 0000 -> 1
+    {{0x4, 0xf}, 0b00, 0b1},   // 0100 -> 1
+    {{0x8, 0xf}, 0b00, 0b1},   // 1000 -> 1
+    {{0x1, 0xf}, 0b00, 0b10},  // 0001 -> 2
+    {{0xc, 0xf}, 0b10, 0b1},   // 1100 -> 1
+  };
+
+  RoutePartition::minimise(table, 0);
+
+  ASSERT_EQ(table.size(), 2u);
+  EXPECT_EQ(table[0], RoutingTable::Entry({{0x0, 0x3}, 0b11, 0b1}));
+  EXPECT_EQ(table[1], RoutingTable::Entry({{0x1, 0xf}, 0b00, 0b10}));
+}
+
+
+TEST(RoutePartitionTest, test_minimise_blocked)
+{
+  // Entries may not be merged past an entry with another route which would
+  // then be covered.
+  RoutingTable::Table table = {
+    {{0x0, 0xf}, 0x0, 0b1},   // 0000 -> 1
+    {{0x1, 0xf}, 0x0, 0b10},  // 0001 -> 2
+    {{0x1, 0xf}, 0x0, 0b1},   // 0001 -> 1 (never matched)
+    {{0x2, 0xf}, 0x0, 0b10},  // 0010 -> 2
+  };
+  const auto expected = table;
+
+  RoutePartition::minimise(table, 0);
+  EXPECT_EQ(table, expected);
+}
+
+
+TEST(RoutePartitionTest, test_minimise_random)
+{
+  // Every key should be routed as it was before minimisation
+  std::mt19937 rng(18);
+  for (unsigned int trial = 0; trial < 20; trial++)
+  {
+    auto table = RoutingTable::Table(300);
+    for (auto& entry : table)
+    {
+      entry.keymask.mask = (rng() | rng() | rng()) & 0x3ff;
+      entry.keymask.key = rng() & entry.keymask.mask;
+      entry.source = 0x0;
+      entry.route = 1 << (rng() % 4);
+    }
+
+    auto minimised = table;
+    RoutePartition::minimise(minimised, 0);
+    EXPECT_LT(minimised.size(), table.size());
+    for (uint32_t key = 0; key < 1024; key++)
+    {
+      ASSERT_EQ(route_key(minimised, key), route_key(table, key));
+    }
+
+    // The same table should be produced for a SoATable
+    auto soa = RoutingTable::SoATable(table);
+    RoutePartition::minimise(soa, 0);
+    EXPECT_EQ(soa.to_table(), minimised);
+
+    // Minimisation stops once the target length is reached
+    auto target = table;
+    RoutePartition::minimise(target, 250);
+    EXPECT_EQ(target.size(), std::max(250u, (unsigned int) minimised.size()));
+    for (uint32_t key = 0; key < 1024; key++)
+    {
+      ASSERT_EQ(route_key(target, key), route_key(table, key));
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "intersect.h"
+#include "soa_table.h"
+
+using RoutingTable::SoATable;
+using RoutingTable::Table;
+
+
+class SoATableTest : public ::testing::Test
+{
+};
+
+
+// Generate a table of random entries
+static Table random_table(std::mt19937& rng, unsigned int length)
+{
+  auto table = Table(length);
+  for (auto& entry : table)
+  {
+    entry.keymask.mask = rng() | 0xfffff000;
+    entry.keymask.key = rng() & entry.keymask.mask;
+    entry.source = rng();
+    entry.route = rng();
+  }
+  return table;
+}
+
+
+TEST(SoATableTest, test_convert_table)
+{
+  Table table = {
+    {{0x0, 0xf}, 0x1, 0x2},
+    {{0x1, 0xf}, 0x4, 0x8},
+    {{0x2, 0xe}, 0x10, 0x20},
+  };
+
+  auto soa = SoATable(table);
+  ASSERT_EQ(soa.size(), 3);
+  EXPECT_EQ(soa.keys[1], 0x1);
+  EXPECT_EQ(soa.masks[2], 0xe);
+  EXPECT_EQ(soa.sources[1], 0x4);
+  EXPECT_EQ(soa.routes[2], 0x20);
+  EXPECT_EQ(soa.to_table(), table);
+
+  // Every field should start on a cache line
+  EXPECT_EQ(((uintptr_t) soa.keys.data()) % 64, 0);
+  EXPECT_EQ(((uintptr_t) soa.masks.data()) % 64, 0);
+  EXPECT_EQ(((uintptr_t) soa.sources.data()) % 64, 0);
+  EXPECT_EQ(((uintptr_t) soa.routes.data()) % 64, 0);
+}
+
+
+TEST(SoATableTest, test_soa_kernels_match_intersect)
+{
+  std::mt19937 rng(3);
+  auto soa = SoATable(random_table(rng, 200));
+
+  for (unsigned int trial = 0; trial < 200; trial++)
+  {
+    const auto km = get_keymask(soa, rng() % soa.size());
+    const unsigned int offset = rng() % (soa.size() - 64);
+    const unsigned int n = trial % 65;
+
+    uint64_t expected = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if (get_keymask(soa, offset + i).intersect(km))
+      {
+        expected |= ((uint64_t) 1) << i;
+      }
+    }
+
+    EXPECT_EQ(Intersect::intersect_soa_scalar(soa.keys.data() + offset,
+                                              soa.masks.data() + offset,
+                                              n, km), expected);
+    EXPECT_EQ(Intersect::get_soa_kernel()(soa.keys.data() + offset,
+                                          soa.masks.data() + offset,
+                                          n, km), expected);
+  }
+}
@@ -0,0 +1,420 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "table_file.h"
+
+using RoutingTable::MappedTableFile;
+using RoutingTable::Table;
+
+
+class TableFileTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+      char path[] = "/tmp/test_table_file_XXXXXX";
+      int fd = mkstemp(path);
+      ASSERT_GE(fd, 0);
+      close(fd);
+      m_path = path;
+    }
+
+    void TearDown() override
+    {
+      unlink(m_path.c_str());
+    }
+
+    std::string m_path;
+};
+
+
+TEST_F(TableFileTest, test_read_tables)
+{
+  Table a = {
+    {{0x0, 0xf}, 0x1, 0x2},
+    {{0x1, 0xf}, 0x4, 0x8},
+  };
+  Table b = {
+    {{0x8, 0x8}, 0x10, 0x20},
+  };
+
+  {
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    RoutingTable::write_table(out, 1, 2, a.data(), a.size());
+    RoutingTable::write_table(out, 3, 4, nullptr, 0);
+    RoutingTable::write_table(out, 5, 6, b.data(), b.size());
+  }
+
+  MappedTableFile file(m_path.c_str());
+  ASSERT_EQ(file.size(), 3);
+
+  EXPECT_EQ(file[0].x, 1);
+  EXPECT_EQ(file[0].y, 2);
+  EXPECT_EQ(file[0].length, 2);
+  EXPECT_EQ(file[0].to_table(), a);
+
+  EXPECT_EQ(file[1].x, 3);
+  EXPECT_EQ(file[1].length, 0);
+  EXPECT_TRUE(file[1].to_table().empty());
+
+  EXPECT_EQ(file[2].y, 6);
+  EXPECT_EQ(file[2].to_table(), b);
+}
+
+
+TEST_F(TableFileTest, test_read_empty_file)
+{
+  MappedTableFile file(m_path.c_str());
+  EXPECT_EQ(file.size(), 0);
+}
+
+
+TEST_F(TableFileTest, test_malformed_files)
+{
+  // A missing file
+  EXPECT_THROW(MappedTableFile("/nonexistent/table/file"),
+               std::runtime_error);
+
+  // A truncated header
+  {
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    out.write("\x01\x02\x03", 3);
+  }
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+
+  // A table with fewer entries than its length claims
+  {
+    Table table = {{{0x0, 0xf}, 0x1, 0x2}};
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    RoutingTable::write_table(out, 0, 0, table.data(), table.size());
+    RoutingTable::write_table(out, 0, 1, table.data(), table.size());
+    out.close();
+    ASSERT_EQ(truncate(m_path.c_str(), 2 * (4 + 16) - 1), 0);
+  }
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+}
+
+
+TEST_F(TableFileTest, test_stream_tables)
+{
+  // Tables written by a TableWriter should be read back by a TableReader
+  Table a = {
+    {{0x0, 0xf}, 0x1, 0x2},
+    {{0x1, 0xf}, 0x4, 0x8},
+  };
+
+  FILE* file = fopen(m_path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  {
+    RoutingTable::TableWriter writer(file, m_path);
+    writer.write(1, 2, a.data(), a.size());
+    writer.write(3, 4, nullptr, 0);
+    writer.flush();
+  }
+  fclose(file);
+
+  file = fopen(m_path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  RoutingTable::TableReader reader(file, m_path);
+
+  unsigned char x, y;
+  Table table;
+  ASSERT_TRUE(reader.next(x, y, table));
+  EXPECT_EQ(x, 1);
+  EXPECT_EQ(y, 2);
+  EXPECT_EQ(table, a);
+
+  ASSERT_TRUE(reader.next(x, y, table));
+  EXPECT_EQ(x, 3);
+  EXPECT_TRUE(table.empty());
+
+  EXPECT_FALSE(reader.next(x, y, table));
+  fclose(file);
+
+  // A truncated stream should be reported
+  ASSERT_EQ(truncate(m_path.c_str(), 4 + 16), 0);
+  file = fopen(m_path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  RoutingTable::TableReader truncated(file, m_path);
+  EXPECT_THROW(truncated.next(x, y, table), std::runtime_error);
+  fclose(file);
+}
+
+
+TEST_F(TableFileTest, test_checksum_and_encoding)
+{
+  EXPECT_EQ(RoutingTable::crc32("123456789", 9), 0xcbf43926u);
+  EXPECT_EQ(RoutingTable::crc32("6789", 4, RoutingTable::crc32("12345", 5)),
+            0xcbf43926u);
+
+  Table table;
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    table.push_back({{0x01020000 | i << 4, 0xfffffff0}, 0x1, 1u << (i % 20)});
+  }
+  table.push_back({{0xffffffff, 0xffffffff}, 0xffffffff, 0x0});
+
+  auto data = std::vector<char>();
+  RoutingTable::encode_entries(table.data(), table.size(), data);
+  EXPECT_LT(data.size(), table.size() * sizeof(RoutingTable::Entry) / 2);
+
+  auto decoded = Table(table.size());
+  const auto* bytes = (const unsigned char*) data.data();
+  ASSERT_TRUE(RoutingTable::decode_entries(bytes, data.size(), table.size(),
+                                           decoded.data()));
+  EXPECT_EQ(decoded, table);
+
+  // Too little or too much data is reported
+  EXPECT_FALSE(RoutingTable::decode_entries(bytes, data.size() - 1,
+                                            table.size(), decoded.data()));
+  EXPECT_FALSE(RoutingTable::decode_entries(bytes, data.size(),
+                                            table.size() - 1, decoded.data()));
+}
+
+
+TEST_F(TableFileTest, test_container)
+{
+  // Containers, compressed or not, should be read back by either reader and
+  // their tables found by co-ordinates.
+  Table a = {
+    {{0x0, 0xf}, 0x1, 0x2},
+    {{0x1, 0xf}, 0x4, 0x8},
+  };
+  Table b(70000);  // Too long for a legacy file
+  for (uint32_t i = 0; i < b.size(); i++)
+  {
+    b[i] = {{i, 0xffffffff}, 0x0, 1u << (i % 32)};
+  }
+
+  for (bool compress : {false, true})
+  {
+    FILE* file = fopen(m_path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    {
+      RoutingTable::TableWriter writer(file, m_path, RoutingTable::CONTAINER,
+                                       compress);
+      writer.write(5, 6, a.data(), a.size());
+      writer.write(3, 4, nullptr, 0);
+      writer.write(1, 2, b.data(), b.size());
+      writer.close();
+    }
+    fclose(file);
+
+    MappedTableFile mapped(m_path.c_str());
+    EXPECT_EQ(mapped.format(), RoutingTable::CONTAINER);
+    ASSERT_EQ(mapped.size(), 3);
+    EXPECT_EQ(mapped[0].x, 5);
+    EXPECT_EQ(mapped[0].to_table(), a);
+    EXPECT_EQ(mapped[1].length, 0);
+    EXPECT_EQ(mapped[2].length, 70000);
+    EXPECT_EQ(mapped[2].to_table(), b);
+
+    ASSERT_NE(mapped.find(1, 2), nullptr);
+    EXPECT_EQ(mapped.find(1, 2), &mapped[2]);
+    EXPECT_EQ(mapped.find(3, 4), &mapped[1]);
+    EXPECT_EQ(mapped.find(2, 1), nullptr);
+
+    file = fopen(m_path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    RoutingTable::TableReader reader(file, m_path);
+    unsigned char x, y;
+    Table table;
+    ASSERT_TRUE(reader.next(x, y, table));
+    EXPECT_EQ(reader.format(), RoutingTable::CONTAINER);
+    EXPECT_EQ(table, a);
+    ASSERT_TRUE(reader.next(x, y, table));
+    EXPECT_TRUE(table.empty());
+    ASSERT_TRUE(reader.next(x, y, table));
+    EXPECT_EQ(x, 1);
+    EXPECT_EQ(y, 2);
+    EXPECT_EQ(table, b);
+    EXPECT_FALSE(reader.next(x, y, table));
+    EXPECT_FALSE(reader.next(x, y, table));
+    fclose(file);
+  }
+
+  // The long table cannot be written to a legacy file
+  FILE* file = fopen(m_path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  RoutingTable::TableWriter legacy(file, m_path);
+  EXPECT_THROW(legacy.write(1, 2, b.data(), b.size()), std::runtime_error);
+  legacy.close();
+  fclose(file);
+}
+
+
+TEST_F(TableFileTest, test_malformed_containers)
+{
+  Table a = {
+    {{0x0, 0xf}, 0x1, 0x2},
+    {{0x1, 0xf}, 0x4, 0x8},
+  };
+
+  auto write_container = [this, &a] ()
+  {
+    FILE* file = fopen(m_path.c_str(), "wb");
+    RoutingTable::TableWriter writer(file, m_path, RoutingTable::CONTAINER);
+    writer.write(1, 2, a.data(), a.size());
+    writer.write(3, 4, a.data(), a.size());
+    writer.close();
+    fclose(file);
+  };
+
+  auto read_stream = [this] ()
+  {
+    FILE* file = fopen(m_path.c_str(), "rb");
+    RoutingTable::TableReader reader(file, m_path);
+    unsigned char x, y;
+    Table table;
+    try
+    {
+      while (reader.next(x, y, table))
+      {
+      }
+    }
+    catch (...)
+    {
+      fclose(file);
+      throw;
+    }
+    fclose(file);
+  };
+
+  // A container without its table of contents
+  write_container();
+  ASSERT_EQ(truncate(m_path.c_str(), 8 + 2 * (16 + 32)), 0);
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+  EXPECT_THROW(read_stream(), std::runtime_error);
+
+  // A corrupted entry of the second table
+  write_container();
+  {
+    FILE* file = fopen(m_path.c_str(), "r+b");
+    ASSERT_EQ(fseek(file, 8 + (16 + 32) + 16 + 4, SEEK_SET), 0);
+    fputc(0x7f, file);
+    fclose(file);
+  }
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+  EXPECT_THROW(read_stream(), std::runtime_error);
+
+  // A table of contents, with a valid checksum, directly after the magic
+  // number which lists a table far beyond the end of the file
+  {
+    RoutingTable::ContainerTocEntry entry = {1, 2, 0, 1, 0x10000000};
+    RoutingTable::ContainerRecord end = {
+      0, 0, RoutingTable::END, 0, 1, sizeof(entry),
+      RoutingTable::crc32(&entry, sizeof(entry))
+    };
+    const uint64_t end_offset = sizeof(RoutingTable::CONTAINER_MAGIC);
+
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    out.write((const char*) RoutingTable::CONTAINER_MAGIC, end_offset);
+    out.write((const char*) &end, sizeof(end));
+    out.write((const char*) &entry, sizeof(entry));
+    out.write((const char*) &end_offset, sizeof(end_offset));
+  }
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+  EXPECT_THROW(read_stream(), std::runtime_error);
+
+  // Records whose data would be gigabytes long, in a stream which ends after
+  // their headers
+  for (uint8_t encoding : {RoutingTable::RAW, RoutingTable::DELTA})
+  {
+    RoutingTable::ContainerRecord record = {
+      1, 2, encoding, 0, 0x0fffffff, 0xfffffff0, 0
+    };
+
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    out.write((const char*) RoutingTable::CONTAINER_MAGIC,
+              sizeof(RoutingTable::CONTAINER_MAGIC));
+    out.write((const char*) &record, sizeof(record));
+    out.close();
+    EXPECT_THROW(read_stream(), std::runtime_error);
+  }
+
+  // A table whose record is listed at an offset which is not a multiple of
+  // the alignment of an entry, which is only accepted once padded to one
+  for (uint64_t offset : {10, 12})
+  {
+    RoutingTable::ContainerRecord record = {
+      1, 2, RoutingTable::RAW, 0, 1, sizeof(a[0]),
+      RoutingTable::crc32(&a[0], sizeof(a[0]))
+    };
+    RoutingTable::ContainerTocEntry entry = {1, 2, 0, 1, offset};
+    RoutingTable::ContainerRecord end = {
+      0, 0, RoutingTable::END, 0, 1, sizeof(entry),
+      RoutingTable::crc32(&entry, sizeof(entry))
+    };
+    const uint64_t end_offset = offset + sizeof(record) + sizeof(a[0]);
+    const char padding[4] = {0};
+
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    out.write((const char*) RoutingTable::CONTAINER_MAGIC,
+              sizeof(RoutingTable::CONTAINER_MAGIC));
+    out.write(padding, offset - sizeof(RoutingTable::CONTAINER_MAGIC));
+    out.write((const char*) &record, sizeof(record));
+    out.write((const char*) &a[0], sizeof(a[0]));
+    out.write((const char*) &end, sizeof(end));
+    out.write((const char*) &entry, sizeof(entry));
+    out.write((const char*) &end_offset, sizeof(end_offset));
+    out.close();
+
+    if (offset % alignof(RoutingTable::Entry))
+    {
+      EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+    }
+    else
+    {
+      MappedTableFile mapped(m_path.c_str());
+      ASSERT_EQ(mapped.size(), 1);
+      EXPECT_EQ(mapped[0].entries[0], a[0]);
+    }
+  }
+
+  // A table of contents truncated part way through
+  write_container();
+  {
+    std::ifstream in(m_path, std::ios::in | std::ios::binary);
+    in.seekg(0, std::ios::end);
+    const long size = in.tellg();
+    in.close();
+    ASSERT_EQ(truncate(m_path.c_str(), size - 12), 0);
+  }
+  EXPECT_THROW(MappedTableFile(m_path.c_str()), std::runtime_error);
+  EXPECT_THROW(read_stream(), std::runtime_error);
+}
+
+
+TEST_F(TableFileTest, test_legacy_stream_like_container)
+{
+  // A legacy file whose first four bytes match the magic number of a
+  // container should still be read as a legacy file.
+  Table table(0x4154);  // 'T', 'A'
+  {
+    std::ofstream out(m_path, std::ios::out | std::ios::binary);
+    RoutingTable::write_table(out, 0x89, 'R', table.data(), table.size());
+  }
+
+  MappedTableFile mapped(m_path.c_str());
+  EXPECT_EQ(mapped.format(), RoutingTable::LEGACY);
+  ASSERT_EQ(mapped.size(), 1);
+  EXPECT_EQ(mapped[0].x, 0x89);
+  EXPECT_EQ(mapped[0].length, table.size());
+
+  FILE* file = fopen(m_path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  RoutingTable::TableReader reader(file, m_path);
+  unsigned char x, y;
+  Table read;
+  ASSERT_TRUE(reader.next(x, y, read));
+  EXPECT_EQ(reader.format(), RoutingTable::LEGACY);
+  EXPECT_EQ(x, 0x89);
+  EXPECT_EQ(y, 'R');
+  EXPECT_EQ(read, table);
+  EXPECT_FALSE(reader.next(x, y, read));
+  fclose(file);
+}
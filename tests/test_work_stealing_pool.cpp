@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "work_stealing_pool.h"
+
+using Parallel::WorkStealingPool;
+
+
+class WorkStealingPoolTest : public ::testing::Test
+{
+};
+
+
+TEST(WorkStealingPoolTest, test_run_every_task_once)
+{
+  for (unsigned int n_workers = 1; n_workers <= 4; n_workers++)
+  {
+    WorkStealingPool pool(n_workers);
+    EXPECT_EQ(pool.size(), n_workers);
+
+    // The pool should be reusable for several batches
+    for (unsigned int n_tasks : {0, 1, 3, 100})
+    {
+      auto tasks = std::vector<unsigned int>();
+      for (unsigned int i = 0; i < n_tasks; i++)
+      {
+        tasks.push_back(n_tasks - 1 - i);
+      }
+
+      auto counts = std::vector<std::atomic<unsigned int>>(n_tasks);
+      pool.run(tasks, [&counts] (unsigned int i) { counts[i]++; });
+
+      for (const auto& count : counts)
+      {
+        EXPECT_EQ(count, 1);
+      }
+    }
+  }
+}
+
+
+TEST(WorkStealingPoolTest, test_run_rethrows)
+{
+  // An exception in any task should be raised by run once the batch is
+  // finished and the pool should remain usable.
+  WorkStealingPool pool(3);
+  auto tasks = std::vector<unsigned int>({0, 1, 2, 3, 4, 5, 6, 7});
+
+  std::atomic<unsigned int> completed(0);
+  EXPECT_THROW(
+    pool.run(tasks, [&completed] (unsigned int i) {
+      if (i == 5)
+      {
+        throw std::runtime_error("task failed");
+      }
+      completed++;
+    }),
+    std::runtime_error
+  );
+  EXPECT_EQ(completed, 7);
+
+  completed = 0;
+  pool.run(tasks, [&completed] (unsigned int) { completed++; });
+  EXPECT_EQ(completed, 8);
+}